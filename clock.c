@@ -0,0 +1,158 @@
+/*
+ * Ian Stephenson   - 44419093
+ * Pok On Cheng     - 75147306
+ * Sung Mo Koo      - 51338217
+ * Cassie Liu       - 52504836
+ */
+
+/*
+ * clock.c - Routines for using the cycle counter. On x86 the counter is
+ * the time stamp counter: start_counter fences and reads it with rdtsc,
+ * and get_counter reads it with rdtscp, which waits for the timed code to
+ * finish, when the processor has it. The clock rate is found once by
+ * comparing the counter against CLOCK_MONOTONIC. Elsewhere the counter
+ * falls back to CLOCK_MONOTONIC itself, counting nanoseconds as cycles of
+ * a 1000 MHz clock.
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "clock.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#define HAVE_TSC 1
+#else
+#define HAVE_TSC 0
+#endif
+
+/* Global variables */
+static uint64_t start;          /* Counter value at the last start_counter */
+static double cpu_mhz;          /* Clock rate found by mhz, or 0 before the first call */
+
+/* Function prototypes for internal helper routines */
+static uint64_t read_start(void);
+static uint64_t read_end(void);
+static uint64_t nsecs(void);
+
+/*
+ * start_counter - Record the current value of the cycle counter
+ */
+void start_counter(void) {
+    start = read_start();
+}
+
+/*
+ * get_counter - Return the number of cycles since the last call to start_counter
+ */
+double get_counter(void) {
+    return (double)(read_end() - start);
+}
+
+/*
+ * ovhd - Return the number of cycles a start_counter/get_counter pair costs on its own, the best of a few tries
+ *        once the code is in the cache
+ */
+double ovhd(void) {
+    double c, best = -1;
+    int i;
+
+    for (i = 0; i < 8; i++) {
+        start_counter();
+        c = get_counter();
+        if (best < 0 || c < best) {
+            best = c;
+        }
+    }
+    return best;
+}
+
+/*
+ * mhz_full - Estimate the clock rate by counting cycles across msecs milliseconds of CLOCK_MONOTONIC. The result
+ *            is kept for later calls to mhz
+ */
+double mhz_full(int verbose, int msecs) {
+    struct timespec pause = { msecs / 1000, (msecs % 1000) * 1000000L };
+    uint64_t t0, t1;
+    double rate;
+
+    t0 = nsecs();
+    start_counter();
+    nanosleep(&pause, NULL);
+    rate = get_counter();
+    t1 = nsecs();
+    rate = rate * 1e3 / (double)(t1 - t0);
+    if (verbose) {
+        printf("Processor clock rate ~= %.1f MHz\n", rate);
+    }
+    cpu_mhz = rate;
+    return rate;
+}
+
+/*
+ * mhz - Return the clock rate in MHz, measuring it the first time
+ */
+double mhz(int verbose) {
+    if (cpu_mhz == 0) {
+        return mhz_full(verbose, 20);
+    }
+    if (verbose) {
+        printf("Processor clock rate ~= %.1f MHz\n", cpu_mhz);
+    }
+    return cpu_mhz;
+}
+
+/*
+ * The remaining routines are internal helper routines
+ */
+
+#if HAVE_TSC
+static int has_rdtscp = -1;     /* Does the processor have rdtscp? -1 until checked */
+
+/*
+ * read_start - Read the counter once every earlier instruction has finished
+ */
+static uint64_t read_start(void) {
+    uint32_t lo, hi;
+
+    __asm__ __volatile__("lfence\n\trdtsc" : "=a" (lo), "=d" (hi) : : "memory");
+    return ((uint64_t)hi << 32) | lo;
+}
+
+/*
+ * read_end - Read the counter after every earlier instruction has finished, with rdtscp if the processor has it
+ */
+static uint64_t read_end(void) {
+    uint32_t lo, hi, aux, a, b, c, d;
+
+    if (has_rdtscp < 0) {
+        has_rdtscp = __get_cpuid(0x80000001, &a, &b, &c, &d) && (d & (1 << 27));
+    }
+    if (has_rdtscp) {
+        __asm__ __volatile__("rdtscp" : "=a" (lo), "=d" (hi), "=c" (aux) : : "memory");
+    }
+    else {
+        __asm__ __volatile__("lfence\n\trdtsc" : "=a" (lo), "=d" (hi) : : "memory");
+    }
+    return ((uint64_t)hi << 32) | lo;
+}
+#else
+static uint64_t read_start(void) {
+    return nsecs();
+}
+
+static uint64_t read_end(void) {
+    return nsecs();
+}
+#endif
+
+/*
+ * nsecs - Return CLOCK_MONOTONIC in nanoseconds
+ */
+static uint64_t nsecs(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
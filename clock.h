@@ -0,0 +1,30 @@
+/*
+ * Ian Stephenson   - 44419093
+ * Pok On Cheng     - 75147306
+ * Sung Mo Koo      - 51338217
+ * Cassie Liu       - 52504836
+ */
+
+#ifndef __CLOCK_H_
+#define __CLOCK_H_
+
+/*
+ * clock.h - Routines for using the cycle counter
+ */
+
+/* Start the counter */
+void start_counter(void);
+
+/* Get # cycles since counter started */
+double get_counter(void);
+
+/* Measure overhead for counter */
+double ovhd(void);
+
+/* Determine clock rate of processor, measuring over at least 20 ms */
+double mhz(int verbose);
+
+/* Determine clock rate of processor, having more control over accuracy */
+double mhz_full(int verbose, int msecs);
+
+#endif /* __CLOCK_H_ */
@@ -77,18 +77,124 @@
 /*
  * Alignment requirement in bytes (either 4 or 8)
  */
-#define ALIGNMENT 4
+#define ALIGNMENT 8
 
 /*
- * Maximum heap size in bytes
+ * Set MM_THREADSAFE to 1 to build a thread-safe allocator: each arena is
+ * guarded by a lock and small blocks are served from per-thread caches.
+ * The single-threaded build takes no locks at all.
+ */
+#ifndef MM_THREADSAFE
+#define MM_THREADSAFE 0
+#endif
+
+/*
+ * Number of arenas in the thread-safe build. Each arena has its own lock
+ * and heap, and threads spread across them to cut lock contention. Only
+ * used when MM_THREADSAFE is 1; the single-threaded build has one arena.
+ */
+#ifndef MM_ARENAS
+#define MM_ARENAS 8
+#endif
+
+/*
+ * Set MM_SLAB to 0 to serve small requests from the boundary tag heap
+ * instead of from slabs.
+ */
+#ifndef MM_SLAB
+#define MM_SLAB 1
+#endif
+
+/*
+ * Set MM_WIDE_TAGS to 1 for 8-byte block headers and footers, so that a
+ * single block can be larger than 4 GB. Blocks are then aligned to 16
+ * bytes. The default keeps the compact 4-byte tags.
+ */
+#ifndef MM_WIDE_TAGS
+#define MM_WIDE_TAGS 0
+#endif
+
+/*
+ * Set MM_TRACE to 1 to build allocation event tracing (mmtrace.c), started
+ * and stopped with mm_trace_start and mm_trace_stop. With 0 the hooks in
+ * mm.c compile to nothing.
+ */
+#ifndef MM_TRACE
+#define MM_TRACE 0
+#endif
+
+/*
+ * Default size in bytes from which requests are mapped directly instead
+ * of carved from the heap; 0 never maps. Change it at runtime with
+ * mm_setopt.
+ */
+#ifndef MM_MMAP_THRESHOLD
+#define MM_MMAP_THRESHOLD (128*1024)
+#endif
+
+/*
+ * Default size in bytes of a free block at the top of the heap that makes
+ * the allocator shrink the heap, and default growth of free memory over its
+ * low point that triggers a sweep releasing the pages inside free blocks to
+ * the OS. 0 turns either off. Both can be changed at runtime with mm_setopt.
+ */
+#ifndef MM_TRIM_THRESHOLD
+#define MM_TRIM_THRESHOLD (128*1024)
+#endif
+#ifndef MM_RELEASE_THRESHOLD
+#define MM_RELEASE_THRESHOLD (4*(1<<20))
+#endif
+
+/*
+ * Largest heap block size in bytes whose free is deferred: such blocks
+ * wait on per-size quick lists for the next request of their size and
+ * are coalesced in batches. 0 coalesces every free at once. It can be
+ * lowered at runtime with mm_setopt.
+ */
+#ifndef MM_QUICK_MAX
+#define MM_QUICK_MAX 1024
+#endif
+
+/*
+ * Maximum heap size in bytes of a secondary arena
  */
 #define MAX_HEAP (20*(1<<20))  /* 20 MB */
 
+/*
+ * Address space reserved for slabs. Like the main heap it costs nothing
+ * until it is used: its pages are committed a piece at a time as slabs
+ * are cut from it.
+ */
+#ifndef SLAB_RESERVE
+#define SLAB_RESERVE ((size_t)1 << (sizeof(void *) == 8 ? 34 : 28))  /* 16 GB, or 256 MB on 32-bit */
+#endif
+
+/*
+ * Default address space reserved for the main heap, and default
+ * granularity in which its pages are committed as it grows. Both can be
+ * changed at runtime with mem_config before mem_init.
+ */
+#ifndef MEM_RESERVE
+#define MEM_RESERVE ((size_t)1 << (sizeof(void *) == 8 ? 36 : 30))  /* 64 GB, or 1 GB on 32-bit */
+#endif
+#ifndef MEM_COMMIT
+#define MEM_COMMIT (64*1024)
+#endif
+
 /*****************************************************************************
  * Set exactly one of these USE_xxx constants to "1" to select a timing method
  *****************************************************************************/
-#define USE_FCYC   1   /* cycle counter w/K-best scheme (x86 & Alpha only) */
+#ifndef USE_FCYC
+#define USE_FCYC   1   /* cycle counter w/K-best scheme (x86; CLOCK_MONOTONIC elsewhere) */
+#endif
+#ifndef USE_ITIMER
 #define USE_ITIMER 0   /* interval timer (any Unix box) */
+#endif
+#ifndef USE_GETTOD
 #define USE_GETTOD 0   /* gettimeofday (any Unix box) */
+#endif
+#ifndef USE_CLOCK
+#define USE_CLOCK  0   /* clock_gettime(CLOCK_MONOTONIC) (any POSIX box) */
+#endif
 
 #endif /* __CONFIG_H */
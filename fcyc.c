@@ -0,0 +1,211 @@
+/*
+ * Ian Stephenson   - 44419093
+ * Pok On Cheng     - 75147306
+ * Sung Mo Koo      - 51338217
+ * Cassie Liu       - 52504836
+ */
+
+/*
+ * fcyc.c - Estimate the time (in CPU cycles) used by a function f using a
+ * "K-best" measurement scheme: f is run over and over, and the K fastest
+ * runs are kept. Once the fastest of them is within a factor of
+ * (1+epsilon) of the K-th fastest, the K runs agree and the fastest is
+ * returned; the slower runs were disturbed by interrupts, other processes
+ * or a cold cache. A run that never converges returns the best of
+ * maxsamples runs. f is run once untimed first, so its code and data are
+ * in the cache; with clear_cache set, the cache is instead flushed before
+ * every run by touching a buffer larger than it.
+ */
+#include <stdlib.h>
+
+#include "fcyc.h"
+#include "clock.h"
+
+/* Default values */
+#define K 3                  /* Value of K in K-best scheme */
+#define MAXSAMPLES 20        /* Give up after MAXSAMPLES */
+#define EPSILON 0.01         /* K samples should be EPSILON of each other*/
+#define CLEAR_CACHE 0        /* Clear cache before running test function */
+#define CACHE_BYTES (1<<19)  /* Max cache size in bytes */
+#define CACHE_BLOCK 64       /* Cache block size in bytes */
+
+/* Global variables */
+static int kbest = K;
+static int maxsamples = MAXSAMPLES;
+static double epsilon = EPSILON;
+static int clear_cache = CLEAR_CACHE;
+static int cache_bytes = CACHE_BYTES;
+static int cache_block = CACHE_BLOCK;
+
+static int *cache_buf = NULL;
+static volatile int sink = 0;  /* Keeps clear() from being optimized away */
+
+static double *values = NULL;
+static int samplecount = 0;
+
+/* Function prototypes for internal helper routines */
+static void init_sampler(void);
+static void add_sample(double val);
+static int has_converged(void);
+static void clear(void);
+
+/*
+ * fcyc - Use K-best scheme to estimate the running time of function f
+ */
+double fcyc(test_funct f, void *argp) {
+    double result;
+
+    init_sampler();
+    if (clear_cache) {
+        do {
+            clear();
+            start_counter();
+            f(argp);
+            add_sample(get_counter());
+        } while (!has_converged() && samplecount < maxsamples);
+    }
+    else {
+        f(argp);                /* Warm up the cache */
+        do {
+            start_counter();
+            f(argp);
+            add_sample(get_counter());
+        } while (!has_converged() && samplecount < maxsamples);
+    }
+    result = values[0];
+    free(values);
+    values = NULL;
+    return result;
+}
+
+/*************************************************************
+ * Set the various parameters used by the measurement routines
+ ************************************************************/
+
+/*
+ * set_fcyc_clear_cache - When set, will run code to clear cache before each measurement.
+ *     Default = 0
+ */
+void set_fcyc_clear_cache(int clear) {
+    clear_cache = clear;
+}
+
+/*
+ * set_fcyc_cache_size - Set size of cache to use when clearing cache
+ *     Default = 1<<19 (512KB)
+ */
+void set_fcyc_cache_size(int bytes) {
+    if (bytes != cache_bytes) {
+        cache_bytes = bytes;
+        free(cache_buf);
+        cache_buf = NULL;
+    }
+}
+
+/*
+ * set_fcyc_cache_block - Set size of cache block
+ *     Default = 64
+ */
+void set_fcyc_cache_block(int bytes) {
+    cache_block = bytes;
+}
+
+/*
+ * set_fcyc_k - Value of K in K-best measurement scheme
+ *     Default = 3
+ */
+void set_fcyc_k(int k) {
+    kbest = k;
+}
+
+/*
+ * set_fcyc_maxsamples - Maximum number of samples attempting to find K-best within some tolerance. When exceeded,
+ *                       just return best sample found.
+ *     Default = 20
+ */
+void set_fcyc_maxsamples(int maxsamples_arg) {
+    maxsamples = maxsamples_arg;
+}
+
+/*
+ * set_fcyc_epsilon - Tolerance required for K-best
+ *     Default = 0.01
+ */
+void set_fcyc_epsilon(double epsilon_arg) {
+    epsilon = epsilon_arg;
+}
+
+/*
+ * The remaining routines are internal helper routines
+ */
+
+/*
+ * init_sampler - Start new sampling process
+ */
+static void init_sampler(void) {
+    free(values);
+    if ((values = calloc(kbest, sizeof(double))) == NULL) {
+        abort();
+    }
+    samplecount = 0;
+}
+
+/*
+ * add_sample - Add new sample, keeping values[] the kbest smallest samples seen so far in increasing order
+ */
+static void add_sample(double val) {
+    int pos = 0;
+
+    if (samplecount < kbest) {
+        pos = samplecount;
+        values[pos] = val;
+    }
+    else if (val < values[kbest-1]) {
+        pos = kbest-1;
+        values[pos] = val;
+    }
+    else {
+        samplecount++;
+        return;
+    }
+    samplecount++;
+
+    /* Insertion sort */
+    while (pos > 0 && values[pos-1] > values[pos]) {
+        double temp = values[pos-1];
+        values[pos-1] = values[pos];
+        values[pos] = temp;
+        pos--;
+    }
+}
+
+/*
+ * has_converged - Have kbest minimum measurements converged within epsilon?
+ */
+static int has_converged(void) {
+    return (samplecount >= kbest) && ((1 + epsilon) * values[0] >= values[kbest-1]);
+}
+
+/*
+ * clear - Code to clear cache
+ */
+static void clear(void) {
+    int x = sink;
+    int *cptr, *cend;
+    int incr = cache_block / sizeof(int);
+
+    if (cache_buf == NULL && (cache_buf = calloc(1, cache_bytes)) == NULL) {
+        abort();
+    }
+    if (incr < 1) {
+        incr = 1;
+    }
+    cptr = cache_buf;
+    cend = cptr + cache_bytes / sizeof(int);
+    while (cptr < cend) {
+        x += *cptr;
+        *cptr = x;
+        cptr += incr;
+    }
+    sink = x;
+}
@@ -0,0 +1,67 @@
+/*
+ * Ian Stephenson   - 44419093
+ * Pok On Cheng     - 75147306
+ * Sung Mo Koo      - 51338217
+ * Cassie Liu       - 52504836
+ */
+
+/*
+ * fsecs.c - Time a function in seconds with whichever of the methods in
+ * fcyc.c (cycle counter, K-best) or ftimer.c (interval timer,
+ * gettimeofday, clock_gettime) is selected by the USE_xxx constants in
+ * config.h.
+ */
+#include <stdio.h>
+
+#include "config.h"
+#include "fsecs.h"
+#include "fcyc.h"
+#include "clock.h"
+#include "ftimer.h"
+
+#if USE_FCYC + USE_ITIMER + USE_GETTOD + USE_CLOCK != 1
+#error "Set exactly one of USE_FCYC, USE_ITIMER, USE_GETTOD and USE_CLOCK in config.h"
+#endif
+
+#define FTIMER_RUNS 10   /* Runs averaged by the coarse timers */
+
+#if USE_FCYC
+static double rate;      /* Clock rate in MHz */
+#endif
+
+/*
+ * init_fsecs - Initialize the timing package
+ */
+void init_fsecs(void) {
+#if USE_FCYC
+    rate = mhz(0);
+    set_fcyc_clear_cache(1);    /* Start every run with a cold cache */
+    set_fcyc_cache_size(1 << 22);
+    set_fcyc_cache_block(64);
+    set_fcyc_k(3);
+    set_fcyc_maxsamples(20);
+    set_fcyc_epsilon(0.01);
+    printf("Measuring performance with a cycle counter (%.0f MHz).\n", rate);
+#elif USE_ITIMER
+    printf("Measuring performance with the interval timer.\n");
+#elif USE_GETTOD
+    printf("Measuring performance with gettimeofday().\n");
+#elif USE_CLOCK
+    printf("Measuring performance with clock_gettime().\n");
+#endif
+}
+
+/*
+ * fsecs - Return the running time of a function f (in seconds)
+ */
+double fsecs(fsecs_test_funct f, void *argp) {
+#if USE_FCYC
+    return fcyc(f, argp) / (rate * 1e6);
+#elif USE_ITIMER
+    return ftimer_itimer(f, argp, FTIMER_RUNS);
+#elif USE_GETTOD
+    return ftimer_gettod(f, argp, FTIMER_RUNS);
+#else
+    return ftimer_clock(f, argp, FTIMER_RUNS);
+#endif
+}
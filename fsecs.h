@@ -0,0 +1,23 @@
+/*
+ * Ian Stephenson   - 44419093
+ * Pok On Cheng     - 75147306
+ * Sung Mo Koo      - 51338217
+ * Cassie Liu       - 52504836
+ */
+
+#ifndef __FSECS_H_
+#define __FSECS_H_
+
+/*
+ * fsecs.h - Time a function in seconds with the method selected in config.h
+ */
+
+typedef void (*fsecs_test_funct)(void *);
+
+/* Set up the timing method; call once before fsecs */
+void init_fsecs(void);
+
+/* Return the running time of f(argp) in seconds */
+double fsecs(fsecs_test_funct f, void *argp);
+
+#endif /* __FSECS_H_ */
@@ -0,0 +1,106 @@
+/*
+ * Ian Stephenson   - 44419093
+ * Pok On Cheng     - 75147306
+ * Sung Mo Koo      - 51338217
+ * Cassie Liu       - 52504836
+ */
+
+/*
+ * ftimer.c - Estimate the time (in seconds) used by a function f with one
+ * of the system's interval clocks. These work on any Unix box but are much
+ * coarser than the cycle counter, so each runs f n times and divides:
+ * ITIMER_PROF ticks at the scheduler rate, gettimeofday has microsecond
+ * resolution, and CLOCK_MONOTONIC nanosecond resolution.
+ */
+#include <stdio.h>
+#include <time.h>
+#include <sys/time.h>
+
+#include "ftimer.h"
+
+#define MAX_ETIME 86400  /* 1 day, the value the interval timer counts down from */
+
+/* Function prototypes for internal helper routines */
+static void init_etime(void);
+static double get_etime(void);
+
+/*
+ * ftimer_itimer - Use the interval timer to estimate the running time of f(argp). Return the average of n runs
+ */
+double ftimer_itimer(ftimer_test_funct f, void *argp, int n) {
+    double start, tmeas;
+    int i;
+
+    init_etime();
+    start = get_etime();
+    for (i = 0; i < n; i++) {
+        f(argp);
+    }
+    tmeas = get_etime() - start;
+    return tmeas / n;
+}
+
+/*
+ * ftimer_gettod - Use gettimeofday to estimate the running time of f(argp). Return the average of n runs
+ */
+double ftimer_gettod(ftimer_test_funct f, void *argp, int n) {
+    struct timeval stv, etv;
+    double diff;
+    int i;
+
+    gettimeofday(&stv, NULL);
+    for (i = 0; i < n; i++) {
+        f(argp);
+    }
+    gettimeofday(&etv, NULL);
+    diff = 1e3 * (etv.tv_sec - stv.tv_sec) + 1e-3 * (etv.tv_usec - stv.tv_usec);
+    diff /= n;
+    return 1e-3 * diff;
+}
+
+/*
+ * ftimer_clock - Use clock_gettime(CLOCK_MONOTONIC) to estimate the running time of f(argp). Return the average
+ *                of n runs
+ */
+double ftimer_clock(ftimer_test_funct f, void *argp, int n) {
+    struct timespec sts, ets;
+    double diff;
+    int i;
+
+    clock_gettime(CLOCK_MONOTONIC, &sts);
+    for (i = 0; i < n; i++) {
+        f(argp);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &ets);
+    diff = (ets.tv_sec - sts.tv_sec) + 1e-9 * (ets.tv_nsec - sts.tv_nsec);
+    return diff / n;
+}
+
+/*
+ * The remaining routines are internal helper routines
+ */
+
+/*
+ * init_etime - Initialize the interval timers
+ */
+static void init_etime(void) {
+    struct itimerval first;
+
+    first.it_interval.tv_sec = 0;
+    first.it_interval.tv_usec = 0;
+    first.it_value.tv_sec = MAX_ETIME;
+    first.it_value.tv_usec = 0;
+    setitimer(ITIMER_PROF, &first, NULL);
+}
+
+/*
+ * get_etime - Return the CPU time in seconds counted by the interval timer since init_etime
+ */
+static double get_etime(void) {
+    struct itimerval v;
+    double t;
+
+    getitimer(ITIMER_PROF, &v);
+    t = (double)(MAX_ETIME - v.it_value.tv_sec - 1) + (double)(1000000 - v.it_value.tv_usec) / 1e6;
+    return t;
+}
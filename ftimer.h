@@ -0,0 +1,27 @@
+/*
+ * Ian Stephenson   - 44419093
+ * Pok On Cheng     - 75147306
+ * Sung Mo Koo      - 51338217
+ * Cassie Liu       - 52504836
+ */
+
+#ifndef __FTIMER_H_
+#define __FTIMER_H_
+
+/*
+ * ftimer.h - Function timers
+ */
+
+/* Function timers: each runs f(argp) n times and returns the average time in seconds */
+typedef void (*ftimer_test_funct)(void *);
+
+/* Estimate secs for f(argp) with the interval timer */
+double ftimer_itimer(ftimer_test_funct f, void *argp, int n);
+
+/* Estimate secs for f(argp) with gettimeofday */
+double ftimer_gettod(ftimer_test_funct f, void *argp, int n);
+
+/* Estimate secs for f(argp) with clock_gettime(CLOCK_MONOTONIC) */
+double ftimer_clock(ftimer_test_funct f, void *argp, int n);
+
+#endif /* __FTIMER_H_ */
@@ -0,0 +1,513 @@
+/*
+ * Ian Stephenson   - 44419093
+ * Pok On Cheng     - 75147306
+ * Sung Mo Koo      - 51338217
+ * Cassie Liu       - 52504836
+ */
+
+/*
+ * gentrace.c - Generate a synthetic .rep trace for mdriver.
+ *
+ * The trace is a simulation in which time is counted in allocations.
+ * Every allocation draws a size from the size distribution and a lifetime
+ * from the lifetime distribution; the block is freed once that many more
+ * allocations have been made. Between allocations a live block is resized
+ * with probability given by the realloc ratio, either grown by a factor
+ * (a buffer being appended to) or redrawn. Every burst period a burst of
+ * blocks is allocated and immediately freed again. Whatever is still live
+ * when the op count is reached is freed at the end, so the trace is
+ * balanced.
+ *
+ * A size distribution is one or more components, each picked with
+ * probability proportional to its weight, which makes bimodal and other
+ * mixed workloads easy to describe:
+ *     [weight@]uniform:lo:hi      sizes uniform in [lo,hi]
+ *     [weight@]lognormal:mu:sigma sizes exp(N(mu,sigma)), rounded
+ *     [weight@]hist:file          sizes drawn from a file of "size count" lines
+ * A lifetime distribution is one of:
+ *     exp:mean       exponential with the given mean (the default, mean 100)
+ *     uniform:lo:hi  uniform in [lo,hi]
+ *     fixed:n        exactly n, which frees blocks in allocation order (producer/consumer)
+ *     forever        live until the end of the trace
+ *
+ * The random number generator is our own, so a seed gives the same trace on every machine.
+ *
+ * Build with: gcc -O2 -I. gentrace.c csapp.c -lpthread -lm
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <math.h>
+
+#include "csapp.h"
+
+/* Misc constants */
+#define MAXDIST     8           /* Max components of the size distribution */
+#define MAXSIZE     (1<<24)     /* Default largest request size (bytes) */
+#define DEFAULT_OPS 10000       /* Default number of ops */
+#define DEFAULT_LIFETIME 100.0  /* Default mean lifetime (allocations) */
+#define GROW_FACTOR 1.5         /* Default growth of a realloc'd buffer */
+#define FOREVER     ((uint64_t)-1)
+
+/* One component of the size distribution */
+typedef struct {
+    enum {UNIFORM, LOGNORMAL, HIST} kind;
+    double weight;              /* Relative probability of this component */
+    double a, b;                /* lo/hi or mu/sigma */
+    size_t *sizes;              /* Histogram sizes ... */
+    double *cum;                /* ... and cumulative weights */
+    int nbins;
+} dist_t;
+
+/* One trace op, kept until the header can be written */
+typedef struct {
+    char type;                  /* 'a', 'r' or 'f' */
+    int id;
+    size_t size;
+} op_t;
+
+/* Global variables */
+static uint64_t rng_state;                      /* xorshift64* state */
+static dist_t dists[MAXDIST];
+static int ndists;
+static double total_weight;
+static enum {LIFE_EXP, LIFE_UNIFORM, LIFE_FIXED, LIFE_FOREVER} life_kind = LIFE_EXP;
+static double life_a = DEFAULT_LIFETIME, life_b;
+static size_t max_size = MAXSIZE;
+
+static op_t *ops;                               /* Ops generated so far */
+static int nops, maxops;
+
+/* Live blocks: an array of ids for picking one at random, and a min-heap on time of death */
+static int *live, nlive;
+static int *heap, nheap;
+static size_t *block_size;                      /* Indexed by id */
+static uint64_t *block_death;
+static int *block_pos;                          /* Position in live[] */
+static int nids, maxids;
+static size_t cur_bytes, peak_bytes;
+
+/* Function prototypes */
+static uint64_t rng_next(void);
+static double rng_uniform(void);
+static double rng_normal(void);
+static void parse_dist(char *spec);
+static void parse_life(char *spec);
+static void read_hist(dist_t *d, char *filename);
+static size_t sample_size(void);
+static uint64_t sample_life(void);
+static void emit(char type, int id, size_t size);
+static int new_block(size_t size, uint64_t death);
+static void free_block(int id);
+static void heap_push(int id);
+static int heap_pop(void);
+static void usage(void);
+
+/*
+ * main - Parse the parameters, run the simulation and write the trace
+ */
+int main(int argc, char **argv) {
+    char *outfile = NULL;       /* Trace file to write, or stdout */
+    int target = DEFAULT_OPS;   /* Ops to generate before freeing what is left */
+    double realloc_ratio = 0;   /* Probability that an op resizes a live block */
+    double grow = GROW_FACTOR;  /* Growth of a resized block, or 0 to redraw its size */
+    int burst_period = 0;       /* Allocations between bursts, 0 for none */
+    int burst_len = 0;          /* Blocks in a burst */
+    uint64_t seed = 1;
+    uint64_t now = 0;           /* Allocations made so far */
+    uint64_t life;
+    FILE *fp;
+    int c, i, id;
+    size_t size;
+
+    while ((c = getopt(argc, argv, "o:n:s:d:l:r:g:b:M:h")) != EOF) {
+        switch (c) {
+        case 'o': /* Output file */
+            outfile = optarg;
+            break;
+        case 'n': /* Op count */
+            target = atoi(optarg);
+            break;
+        case 's': /* Seed */
+            seed = strtoull(optarg, NULL, 0);
+            break;
+        case 'd': /* Add a component to the size distribution */
+            parse_dist(optarg);
+            break;
+        case 'l': /* Lifetime distribution */
+            parse_life(optarg);
+            break;
+        case 'r': /* Realloc ratio */
+            realloc_ratio = atof(optarg);
+            break;
+        case 'g': /* Realloc growth factor */
+            grow = atof(optarg);
+            break;
+        case 'b': /* Bursts: period:length */
+            if (sscanf(optarg, "%d:%d", &burst_period, &burst_len) != 2 || burst_period < 0 || burst_len < 0)
+                app_error("Bad burst spec, expected period:length");
+            break;
+        case 'M': /* Largest request size */
+            max_size = strtoul(optarg, NULL, 0);
+            break;
+        case 'h': /* Print this message */
+            usage();
+            exit(0);
+        default:
+            usage();
+            exit(1);
+        }
+    }
+    if (target <= 0 || realloc_ratio < 0 || realloc_ratio >= 1 || grow < 0 || max_size == 0)
+        app_error("Bad parameters");
+    if (ndists == 0)
+        parse_dist("uniform:1:1024");
+    rng_state = seed ? seed : 1;
+
+    /* Simulate until the op count is reached */
+    while (nops < target) {
+        /* Free everything whose time has come */
+        while (nheap > 0 && block_death[heap[0]] <= now)
+            free_block(heap_pop());
+
+        if (nlive > 0 && rng_uniform() < realloc_ratio) {
+            /* Resize a random live block */
+            id = live[(int)(rng_uniform() * nlive)];
+            if (grow > 0)
+                size = (size_t)(block_size[id] * grow) + 1;
+            else
+                size = sample_size();
+            if (size > max_size)
+                size = max_size;
+            cur_bytes += size - block_size[id];
+            block_size[id] = size;
+            emit('r', id, size);
+        }
+        else {
+            size = sample_size();
+            life = sample_life();
+            id = new_block(size, life == FOREVER ? FOREVER : now + 1 + life);
+            emit('a', id, size);
+            now++;
+
+            /* A burst of short-lived blocks */
+            if (burst_period > 0 && now % burst_period == 0) {
+                int first = nids;
+
+                for (i = 0; i < burst_len; i++) {
+                    size = sample_size();
+                    emit('a', new_block(size, FOREVER), size);
+                }
+                for (i = first; i < first + burst_len; i++)
+                    free_block(i);
+            }
+        }
+        if (cur_bytes > peak_bytes)
+            peak_bytes = cur_bytes;
+    }
+
+    /* Free whatever is left, so the trace is balanced */
+    while (nlive > 0)
+        free_block(live[nlive-1]);
+
+    /* Write the trace */
+    if (outfile == NULL)
+        fp = stdout;
+    else if ((fp = fopen(outfile, "w")) == NULL)
+        unix_error("Could not open output file");
+    fprintf(fp, "%lu\n%d\n%d\n1\n", (unsigned long)peak_bytes, nids, nops);
+    for (i = 0; i < nops; i++) {
+        if (ops[i].type == 'f')
+            fprintf(fp, "f %d\n", ops[i].id);
+        else
+            fprintf(fp, "%c %d %lu\n", ops[i].type, ops[i].id, (unsigned long)ops[i].size);
+    }
+    if (fp != stdout)
+        fclose(fp);
+    return 0;
+}
+
+/*
+ * rng_next - Return the next number of a xorshift64* generator
+ */
+static uint64_t rng_next(void) {
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return rng_state * 0x2545F4914F6CDD1DULL;
+}
+
+/*
+ * rng_uniform - Return a random number in [0,1)
+ */
+static double rng_uniform(void) {
+    return (rng_next() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/*
+ * rng_normal - Return a standard normal random number (Box-Muller)
+ */
+static double rng_normal(void) {
+    double u = 1.0 - rng_uniform();
+
+    return sqrt(-2.0 * log(u)) * cos(2.0 * M_PI * rng_uniform());
+}
+
+/*
+ * parse_dist - Add the component described by spec to the size distribution
+ */
+static void parse_dist(char *spec) {
+    dist_t *d;
+
+    if (ndists == MAXDIST)
+        app_error("Too many size distributions");
+    d = &dists[ndists];
+    d->weight = 1;
+    if (strchr(spec, '@') != NULL) {
+        d->weight = atof(spec);
+        spec = strchr(spec, '@') + 1;
+    }
+    if (strncmp(spec, "uniform:", 8) == 0 && sscanf(spec + 8, "%lf:%lf", &d->a, &d->b) == 2 && d->a <= d->b) {
+        d->kind = UNIFORM;
+    }
+    else if (strncmp(spec, "lognormal:", 10) == 0 && sscanf(spec + 10, "%lf:%lf", &d->a, &d->b) == 2) {
+        d->kind = LOGNORMAL;
+    }
+    else if (strncmp(spec, "hist:", 5) == 0) {
+        d->kind = HIST;
+        read_hist(d, spec + 5);
+    }
+    else {
+        app_error("Bad size distribution");
+    }
+    if (d->weight <= 0)
+        app_error("Size distribution weights must be positive");
+    total_weight += d->weight;
+    ndists++;
+}
+
+/*
+ * parse_life - Set the lifetime distribution from spec
+ */
+static void parse_life(char *spec) {
+    if (strncmp(spec, "exp:", 4) == 0 && sscanf(spec + 4, "%lf", &life_a) == 1 && life_a > 0)
+        life_kind = LIFE_EXP;
+    else if (strncmp(spec, "uniform:", 8) == 0 && sscanf(spec + 8, "%lf:%lf", &life_a, &life_b) == 2 &&
+             life_a >= 0 && life_a <= life_b)
+        life_kind = LIFE_UNIFORM;
+    else if (strncmp(spec, "fixed:", 6) == 0 && sscanf(spec + 6, "%lf", &life_a) == 1 && life_a >= 0)
+        life_kind = LIFE_FIXED;
+    else if (strcmp(spec, "forever") == 0)
+        life_kind = LIFE_FOREVER;
+    else
+        app_error("Bad lifetime distribution");
+}
+
+/*
+ * read_hist - Read a histogram of "size count" lines into d
+ */
+static void read_hist(dist_t *d, char *filename) {
+    FILE *fp;
+    unsigned long size;
+    double count, sum = 0;
+    int max = 0;
+
+    if ((fp = fopen(filename, "r")) == NULL)
+        unix_error("Could not open histogram file");
+    d->nbins = 0;
+    d->sizes = NULL;
+    d->cum = NULL;
+    while (fscanf(fp, "%lu %lf", &size, &count) == 2) {
+        if (count <= 0)
+            continue;
+        if (d->nbins == max) {
+            max = max ? 2 * max : 64;
+            if ((d->sizes = realloc(d->sizes, max * sizeof(size_t))) == NULL ||
+                (d->cum = realloc(d->cum, max * sizeof(double))) == NULL)
+                unix_error("realloc failed in read_hist");
+        }
+        sum += count;
+        d->sizes[d->nbins] = size;
+        d->cum[d->nbins] = sum;
+        d->nbins++;
+    }
+    fclose(fp);
+    if (d->nbins == 0)
+        app_error("Empty histogram file");
+}
+
+/*
+ * sample_size - Draw a request size, at least 1 and at most max_size
+ */
+static size_t sample_size(void) {
+    double u = rng_uniform() * total_weight;
+    double x = 1;
+    dist_t *d;
+    int lo, hi, mid;
+
+    for (d = dists; d < dists + ndists - 1 && u >= d->weight; d++)
+        u -= d->weight;
+    switch (d->kind) {
+    case UNIFORM:
+        x = d->a + floor(rng_uniform() * (d->b - d->a + 1));
+        break;
+    case LOGNORMAL:
+        x = floor(exp(d->a + d->b * rng_normal()) + 0.5);
+        break;
+    case HIST:
+        /* Binary search for the first bin whose cumulative weight exceeds u */
+        u = rng_uniform() * d->cum[d->nbins-1];
+        lo = 0;
+        hi = d->nbins - 1;
+        while (lo < hi) {
+            mid = (lo + hi) / 2;
+            if (d->cum[mid] > u)
+                hi = mid;
+            else
+                lo = mid + 1;
+        }
+        x = d->sizes[lo];
+        break;
+    }
+    if (x < 1)
+        return 1;
+    if (x > max_size)
+        return max_size;
+    return (size_t)x;
+}
+
+/*
+ * sample_life - Draw a lifetime in allocations, or FOREVER
+ */
+static uint64_t sample_life(void) {
+    switch (life_kind) {
+    case LIFE_EXP:
+        return (uint64_t)(-life_a * log(1.0 - rng_uniform()));
+    case LIFE_UNIFORM:
+        return (uint64_t)(life_a + floor(rng_uniform() * (life_b - life_a + 1)));
+    case LIFE_FIXED:
+        return (uint64_t)life_a;
+    default:
+        return FOREVER;
+    }
+}
+
+/*
+ * emit - Append an op to the trace
+ */
+static void emit(char type, int id, size_t size) {
+    if (nops == maxops) {
+        maxops = maxops ? 2 * maxops : 4096;
+        if ((ops = realloc(ops, maxops * sizeof(op_t))) == NULL)
+            unix_error("realloc failed in emit");
+    }
+    ops[nops].type = type;
+    ops[nops].id = id;
+    ops[nops].size = size;
+    nops++;
+}
+
+/*
+ * new_block - Make a live block of size bytes that dies at time death. Returns its id
+ */
+static int new_block(size_t size, uint64_t death) {
+    int id = nids++;
+
+    if (id == maxids) {
+        maxids = maxids ? 2 * maxids : 4096;
+        if ((block_size = realloc(block_size, maxids * sizeof(size_t))) == NULL ||
+            (block_death = realloc(block_death, maxids * sizeof(uint64_t))) == NULL ||
+            (block_pos = realloc(block_pos, maxids * sizeof(int))) == NULL ||
+            (live = realloc(live, maxids * sizeof(int))) == NULL ||
+            (heap = realloc(heap, maxids * sizeof(int))) == NULL)
+            unix_error("realloc failed in new_block");
+    }
+    block_size[id] = size;
+    block_death[id] = death;
+    block_pos[id] = nlive;
+    live[nlive++] = id;
+    cur_bytes += size;
+    if (death != FOREVER)
+        heap_push(id);
+    return id;
+}
+
+/*
+ * free_block - Free live block id and emit the free
+ */
+static void free_block(int id) {
+    int pos = block_pos[id];
+
+    live[pos] = live[--nlive];
+    block_pos[live[pos]] = pos;
+    cur_bytes -= block_size[id];
+    emit('f', id, 0);
+}
+
+/*
+ * heap_push - Add block id to the heap of blocks ordered by time of death. Ties go to the older block, so fixed
+ *             lifetimes free blocks in allocation order
+ */
+static void heap_push(int id) {
+    int i = nheap++;
+    int parent;
+
+    while (i > 0) {
+        parent = (i - 1) / 2;
+        if (block_death[heap[parent]] < block_death[id] ||
+            (block_death[heap[parent]] == block_death[id] && heap[parent] < id))
+            break;
+        heap[i] = heap[parent];
+        i = parent;
+    }
+    heap[i] = id;
+}
+
+/*
+ * heap_pop - Remove and return the block that dies first
+ */
+static int heap_pop(void) {
+    int top = heap[0];
+    int last = heap[--nheap];
+    int i = 0, child;
+
+    for (;;) {
+        child = 2 * i + 1;
+        if (child >= nheap)
+            break;
+        if (child + 1 < nheap && (block_death[heap[child+1]] < block_death[heap[child]] ||
+            (block_death[heap[child+1]] == block_death[heap[child]] && heap[child+1] < heap[child])))
+            child++;
+        if (block_death[last] < block_death[heap[child]] ||
+            (block_death[last] == block_death[heap[child]] && last < heap[child]))
+            break;
+        heap[i] = heap[child];
+        i = child;
+    }
+    if (nheap > 0)
+        heap[i] = last;
+    return top;
+}
+
+/*
+ * usage - Explain the command line arguments
+ */
+static void usage(void) {
+    fprintf(stderr, "Usage: gentrace [-h] [-o <file>] [-n <ops>] [-s <seed>] [-d <dist>]... [-l <life>]\n");
+    fprintf(stderr, "                [-r <ratio>] [-g <factor>] [-b <period>:<len>] [-M <bytes>]\n");
+    fprintf(stderr, "Options\n");
+    fprintf(stderr, "\t-o <file>          Write the trace to <file> instead of stdout.\n");
+    fprintf(stderr, "\t-n <ops>           Generate about <ops> ops (default %d).\n", DEFAULT_OPS);
+    fprintf(stderr, "\t-s <seed>          Seed the random number generator (default 1).\n");
+    fprintf(stderr, "\t-d <dist>          Add a size distribution component:\n");
+    fprintf(stderr, "\t                   [w@]uniform:lo:hi, [w@]lognormal:mu:sigma or [w@]hist:file.\n");
+    fprintf(stderr, "\t-l <life>          Lifetime in allocations: exp:mean, uniform:lo:hi, fixed:n or forever.\n");
+    fprintf(stderr, "\t-r <ratio>         Fraction of ops that resize a live block (default 0).\n");
+    fprintf(stderr, "\t-g <factor>        Growth of a resized block, 0 to draw a new size (default %.1f).\n",
+            GROW_FACTOR);
+    fprintf(stderr, "\t-b <period>:<len>  Every <period> allocations, allocate and free <len> blocks.\n");
+    fprintf(stderr, "\t-M <bytes>         Largest request size (default %d).\n", MAXSIZE);
+    fprintf(stderr, "\t-h                 Print this message.\n");
+}
@@ -0,0 +1,815 @@
+/*
+ * Ian Stephenson   - 44419093
+ * Pok On Cheng     - 75147306
+ * Sung Mo Koo      - 51338217
+ * Cassie Liu       - 52504836
+ */
+
+/*
+ * mdriver.c - Trace-driven benchmark driver for the allocator in mm.c.
+ *
+ * Each trace file (a .rep file) is replayed three times against
+ * mm_malloc/mm_free/mm_realloc: once to check that the allocator is
+ * correct, once to measure its peak space utilization, and once, with no
+ * checking at all, to measure its throughput. Correctness means every
+ * payload is aligned to ALIGNMENT, no two live payloads overlap, and a
+ * payload keeps its contents until it is freed (across mm_realloc, up to
+ * the smaller of the two sizes). The performance index weighs utilization
+ * against throughput as set by UTIL_WEIGHT, MAX_SPACE and MAX_SPEED in
+ * config.h. With -l the traces are also run against the C library's
+ * malloc package as a baseline.
+ *
+ * A .rep file starts with four numbers: suggested heap size, number of
+ * block ids, number of ops and weight. One op follows per line:
+ *     a <id> <size>     allocate a block of size bytes and call it id
+ *     r <id> <size>     resize block id to size bytes
+ *     f <id>            free block id
+ *
+ * Build with: gcc -O2 -I. mdriver.c mm.c memlib.c csapp.c fsecs.c fcyc.c clock.c ftimer.c -lpthread
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+
+#include "config.h"
+#include "csapp.h"
+#include "fsecs.h"
+#include "memlib.h"
+#include "mm.h"
+
+/* Misc constants */
+#define LINENUM(i)  (i+5)    /* Trace line i is the (i+5)th line of the file */
+
+/* Returns true if p is ALIGNMENT-byte aligned */
+#define IS_ALIGNED(p)  ((((uintptr_t)(p)) % ALIGNMENT) == 0)
+
+/* Byte that offset j of the payload of block id must hold while the block is live */
+#define PATTERN(id, j)  ((char)((id) * 31 + (j)))
+
+/*
+ * Range of one live payload, kept in a splay tree ordered by lo so that an overlap with a new payload is found in
+ * its neighbours
+ */
+typedef struct range_t {
+    char *lo;                   /* Low payload address */
+    char *hi;                   /* High payload address */
+    struct range_t *left;
+    struct range_t *right;
+} range_t;
+
+/* Characterizes a single trace operation (allocator request) */
+typedef struct {
+    enum {ALLOC, FREE, REALLOC} type;   /* Type of request */
+    int index;                          /* Index for free() to use later */
+    size_t size;                        /* Byte size of alloc/realloc request */
+} traceop_t;
+
+/* Holds the information for one trace file */
+typedef struct {
+    int sugg_heapsize;          /* Suggested heap size (unused) */
+    int num_ids;                /* Number of alloc/realloc ids */
+    int num_ops;                /* Number of distinct requests */
+    int weight;                 /* Weight for this trace (unused) */
+    traceop_t *ops;             /* Array of requests */
+    char **blocks;              /* Array of ptrs returned by malloc/realloc... */
+    size_t *block_sizes;        /* ... and a corresponding array of payload sizes */
+    range_t *ranges;            /* ... and of their splay tree nodes */
+} trace_t;
+
+/* Summarizes the important stats for some malloc function on some trace */
+typedef struct {
+    double ops;                 /* Number of ops (malloc/free/realloc) in the trace */
+    int valid;                  /* Was the trace processed correctly by the allocator? */
+    double secs;                /* Number of secs needed to run the trace */
+    double util;                /* Space utilization for this trace (mm only) */
+} stats_t;
+
+/* The functions being measured, and the operations they are applied to */
+typedef struct {
+    void *(*malloc_fn)(size_t size);
+    void (*free_fn)(void *ptr);
+    void *(*realloc_fn)(void *ptr, size_t size);
+    int reset;                  /* Reset the simulated heap before each run (mm only) */
+} funcs_t;
+
+/* Parameters of a timed run, passed through fsecs */
+typedef struct {
+    trace_t *trace;
+    funcs_t *funcs;
+} speed_t;
+
+/* Global variables */
+static int verbose = 0;         /* Print progress and per-trace results */
+static range_t *range_root;     /* Live payloads of the trace being checked */
+static char msg[MAXLINE + 128]; /* For whenever we need to compose an error message; room for a path and the text around it */
+
+/* Default tracefiles in TRACEDIR */
+static char *default_tracefiles[] = {
+    DEFAULT_TRACEFILES, NULL
+};
+
+static funcs_t mm_funcs = { mm_malloc, mm_free, mm_realloc, 1 };
+static funcs_t libc_funcs = { malloc, free, realloc, 0 };
+
+/* Function prototypes */
+static trace_t *read_trace(char *tracedir, char *filename);
+static void free_trace(trace_t *trace);
+static int eval_valid(trace_t *trace, int tracenum, funcs_t *f);
+static double eval_mm_util(trace_t *trace);
+static void run_ops(trace_t *trace, funcs_t *f);
+static void eval_speed(void *ptr);
+static double time_run(trace_t *trace, funcs_t *f);
+static int add_range(trace_t *trace, int index, char *lo, size_t size, int tracenum, int opnum);
+static void remove_range(trace_t *trace, int index);
+static range_t *splay(range_t *t, char *lo);
+static int check_payload(trace_t *trace, int index, size_t size, int tracenum, int opnum);
+static void fill_payload(trace_t *trace, int index);
+static void printresults(int n, stats_t *stats);
+static void malloc_error(int tracenum, int opnum, char *msg);
+static void usage(void);
+
+/*
+ * main - Run every trace through the checks and measurements and print the results and the performance index
+ */
+int main(int argc, char **argv) {
+    char **tracefiles = NULL;           /* Null-terminated array of trace file names */
+    int num_tracefiles = 0;             /* The number of traces in that array */
+    trace_t *trace = NULL;              /* Stores a single trace file in memory */
+    stats_t *libc_stats = NULL;         /* libc stats for each trace */
+    stats_t *mm_stats = NULL;           /* mm (i.e. student) stats for each trace */
+    char tracedir[MAXLINE] = TRACEDIR;  /* Directory holding the trace files */
+    int run_libc = 0;                   /* If set, run libc malloc (set by -l) */
+    double secs, ops, util, avg_util, thru, p1, p2;
+    int i, c, numcorrect;
+
+    while ((c = getopt(argc, argv, "f:t:hlvV")) != EOF) {
+        switch (c) {
+        case 'f': /* Use one specific trace file only (path as given) */
+            num_tracefiles = 1;
+            if ((tracefiles = realloc(tracefiles, 2*sizeof(char *))) == NULL)
+                unix_error("ERROR: realloc failed in main");
+            tracedir[0] = '\0';
+            tracefiles[0] = strdup(optarg);
+            tracefiles[1] = NULL;
+            break;
+        case 't': /* Directory where the traces are located */
+            if (num_tracefiles == 1) /* Ignore if -f already encountered */
+                break;
+            if (strlen(optarg) + 2 > sizeof(tracedir))
+                app_error("Trace directory name too long");
+            snprintf(tracedir, sizeof(tracedir), "%s%s", optarg,
+                     optarg[0] != '\0' && optarg[strlen(optarg)-1] == '/' ? "" : "/"); /* Path always ends with "/" */
+            break;
+        case 'l': /* Run libc malloc */
+            run_libc = 1;
+            break;
+        case 'v': /* Print per-trace performance breakdown */
+            verbose = 1;
+            break;
+        case 'V': /* Be more verbose than -v */
+            verbose = 2;
+            break;
+        case 'h': /* Print this message */
+            usage();
+            exit(0);
+        default:
+            usage();
+            exit(1);
+        }
+    }
+
+    /* If no -f command line arg, then use the entire set of tracefiles defined in default_traces[] */
+    if (tracefiles == NULL) {
+        tracefiles = default_tracefiles;
+        num_tracefiles = sizeof(default_tracefiles) / sizeof(char *) - 1;
+        printf("Using default tracefiles in %s\n", tracedir);
+    }
+
+    /* Initialize the simulated memory system in memlib.c */
+    mem_init();
+
+    /* Initialize the timing package */
+    init_fsecs();
+
+    /* Evaluate the libc malloc package on every trace */
+    if (run_libc) {
+        if (verbose > 1)
+            printf("\nTesting libc malloc\n");
+        if ((libc_stats = calloc(num_tracefiles, sizeof(stats_t))) == NULL)
+            unix_error("libc_stats calloc in main failed");
+        for (i = 0; i < num_tracefiles; i++) {
+            trace = read_trace(tracedir, tracefiles[i]);
+            libc_stats[i].ops = trace->num_ops;
+            if (verbose > 1)
+                printf("Checking libc malloc for correctness, ");
+            libc_stats[i].valid = eval_valid(trace, i, &libc_funcs);
+            if (libc_stats[i].valid) {
+                if (verbose > 1)
+                    printf("and performance.\n");
+                libc_stats[i].secs = time_run(trace, &libc_funcs);
+            }
+            free_trace(trace);
+        }
+        if (verbose) {
+            printf("\nResults for libc malloc:\n");
+            printresults(num_tracefiles, libc_stats);
+        }
+    }
+
+    /* Always evaluate the mm.c malloc package on every trace */
+    if (verbose > 1)
+        printf("\nTesting mm malloc\n");
+    if ((mm_stats = calloc(num_tracefiles, sizeof(stats_t))) == NULL)
+        unix_error("mm_stats calloc in main failed");
+    for (i = 0; i < num_tracefiles; i++) {
+        trace = read_trace(tracedir, tracefiles[i]);
+        mm_stats[i].ops = trace->num_ops;
+        if (verbose > 1)
+            printf("Checking mm_malloc for correctness, ");
+        mm_stats[i].valid = eval_valid(trace, i, &mm_funcs);
+        if (mm_stats[i].valid) {
+            if (verbose > 1)
+                printf("efficiency, ");
+            mm_stats[i].util = eval_mm_util(trace);
+            if (verbose > 1)
+                printf("and performance.\n");
+            mm_stats[i].secs = time_run(trace, &mm_funcs);
+        }
+        free_trace(trace);
+    }
+    if (verbose) {
+        printf("\nResults for mm malloc:\n");
+        printresults(num_tracefiles, mm_stats);
+        printf("\n");
+    }
+
+    /* Accumulate the aggregate statistics for the mm package */
+    secs = 0;
+    ops = 0;
+    util = 0;
+    numcorrect = 0;
+    for (i = 0; i < num_tracefiles; i++) {
+        secs += mm_stats[i].secs;
+        ops += mm_stats[i].ops;
+        util += mm_stats[i].util;
+        if (mm_stats[i].valid)
+            numcorrect++;
+    }
+    avg_util = util / num_tracefiles;
+
+    /* Compute and print the performance index */
+    if (numcorrect == num_tracefiles) {
+        thru = secs > 0 ? ops / secs : MAX_SPEED;
+        p1 = UTIL_WEIGHT * (avg_util < MAX_SPACE ? avg_util / MAX_SPACE : 1.0);
+        p2 = (1.0 - UTIL_WEIGHT) * (thru < MAX_SPEED ? thru / MAX_SPEED : 1.0);
+        printf("Average utilization = %.1f%%. Average throughput = %.0f Kops/sec\n", avg_util * 100.0, thru / 1e3);
+        printf("Perf index = %.0f (util) + %.0f (thru) = %.0f/100\n", p1 * 100, p2 * 100, (p1 + p2) * 100);
+    }
+    else {
+        printf("Terminated with %d errors\n", num_tracefiles - numcorrect);
+    }
+    exit(numcorrect == num_tracefiles ? 0 : 1);
+}
+
+/*
+ * read_trace - read a trace file and store it in memory
+ */
+static trace_t *read_trace(char *tracedir, char *filename) {
+    FILE *tracefile;
+    trace_t *trace;
+    char type[MAXLINE];
+    char path[MAXLINE];
+    unsigned long index, size;
+    unsigned long max_index = 0;
+    unsigned long op_index;
+
+    if (verbose > 1)
+        printf("Reading tracefile: %s\n", filename);
+
+    /* Allocate the trace record */
+    if ((trace = (trace_t *) malloc(sizeof(trace_t))) == NULL)
+        unix_error("malloc 1 failed in read_trace");
+
+    /* Read the trace file header */
+    if (snprintf(path, sizeof(path), "%s%s", tracedir, filename) >= (int)sizeof(path))
+        app_error("Tracefile path too long in read_trace");
+    if ((tracefile = fopen(path, "r")) == NULL) {
+        snprintf(msg, sizeof(msg), "Could not open %s in read_trace", path);
+        unix_error(msg);
+    }
+    if (fscanf(tracefile, "%d", &(trace->sugg_heapsize)) != 1 ||
+        fscanf(tracefile, "%d", &(trace->num_ids)) != 1 ||
+        fscanf(tracefile, "%d", &(trace->num_ops)) != 1 ||
+        fscanf(tracefile, "%d", &(trace->weight)) != 1 ||
+        trace->num_ids < 0 || trace->num_ops < 0) {
+        snprintf(msg, sizeof(msg), "Bad header in tracefile %s", path);
+        app_error(msg);
+    }
+
+    /* We'll store each request line in the trace in this array */
+    if ((trace->ops = (traceop_t *)malloc(trace->num_ops * sizeof(traceop_t) + 1)) == NULL)
+        unix_error("malloc 2 failed in read_trace");
+
+    /* We'll keep an array of pointers to the allocated blocks here... */
+    if ((trace->blocks = (char **)calloc(trace->num_ids + 1, sizeof(char *))) == NULL)
+        unix_error("malloc 3 failed in read_trace");
+
+    /* ... along with the corresponding byte sizes of each block */
+    if ((trace->block_sizes = (size_t *)calloc(trace->num_ids + 1, sizeof(size_t))) == NULL)
+        unix_error("malloc 4 failed in read_trace");
+
+    /* ... and the splay tree node of each block */
+    if ((trace->ranges = (range_t *)calloc(trace->num_ids + 1, sizeof(range_t))) == NULL)
+        unix_error("malloc 5 failed in read_trace");
+
+    /* Read every request line in the trace file */
+    index = 0;
+    op_index = 0;
+    while (op_index < (unsigned long)trace->num_ops && fscanf(tracefile, "%s", type) != EOF) {
+        switch (type[0]) {
+        case 'a':
+        case 'r':
+            if (fscanf(tracefile, "%lu %lu", &index, &size) != 2)
+                break;
+            trace->ops[op_index].type = type[0] == 'a' ? ALLOC : REALLOC;
+            trace->ops[op_index].index = index;
+            trace->ops[op_index].size = size;
+            max_index = (index > max_index) ? index : max_index;
+            op_index++;
+            continue;
+        case 'f':
+            if (fscanf(tracefile, "%lu", &index) != 1)
+                break;
+            trace->ops[op_index].type = FREE;
+            trace->ops[op_index].index = index;
+            op_index++;
+            continue;
+        default:
+            break;
+        }
+        snprintf(msg, sizeof(msg), "Bogus type character (%c) in tracefile %s, line %lu",
+                 type[0], path, LINENUM(op_index));
+        app_error(msg);
+    }
+    fclose(tracefile);
+    if (op_index != (unsigned long)trace->num_ops || max_index >= (unsigned long)trace->num_ids) {
+        snprintf(msg, sizeof(msg), "Tracefile %s does not match its header", path);
+        app_error(msg);
+    }
+    return trace;
+}
+
+/*
+ * free_trace - Free the trace record and the four arrays it points to, all of which were allocated in read_trace().
+ */
+static void free_trace(trace_t *trace) {
+    free(trace->ops);
+    free(trace->blocks);
+    free(trace->block_sizes);
+    free(trace->ranges);
+    free(trace);
+}
+
+/*
+ * eval_valid - Check the malloc package f for correctness on trace. Returns 1 if it is correct, else 0 after
+ *              reporting the first error
+ */
+static int eval_valid(trace_t *trace, int tracenum, funcs_t *f) {
+    char *p, *oldp;
+    size_t size, oldsize;
+    int i, index;
+
+    /* Reset the heap and free any records in the range tree */
+    if (f->reset) {
+        mem_reset_brk();
+        if (mm_init() < 0) {
+            malloc_error(tracenum, 0, "mm_init failed.");
+            return 0;
+        }
+    }
+    range_root = NULL;
+    memset(trace->blocks, 0, trace->num_ids * sizeof(char *));
+
+    /* Interpret each operation in the trace in order */
+    for (i = 0; i < trace->num_ops; i++) {
+        index = trace->ops[i].index;
+        size = trace->ops[i].size;
+
+        switch (trace->ops[i].type) {
+        case ALLOC: /* malloc */
+            /* Call the function and test for failure */
+            if ((p = f->malloc_fn(size)) == NULL && size != 0) {
+                malloc_error(tracenum, i, "malloc failed.");
+                return 0;
+            }
+            if (trace->blocks[index] != NULL) {
+                malloc_error(tracenum, i, "id allocated twice.");
+                return 0;
+            }
+            if (p == NULL) /* A zero-byte request may return NULL */
+                break;
+
+            /* Test that the payload is aligned and does not overlap any live payload */
+            if (add_range(trace, index, p, size, tracenum, i) == 0)
+                return 0;
+            trace->blocks[index] = p;
+            trace->block_sizes[index] = size;
+            fill_payload(trace, index);
+            break;
+
+        case REALLOC: /* realloc */
+            oldp = trace->blocks[index];
+            oldsize = trace->block_sizes[index];
+            if (oldp != NULL && check_payload(trace, index, oldsize, tracenum, i) == 0)
+                return 0;
+            if ((p = f->realloc_fn(oldp, size)) == NULL && size != 0) {
+                malloc_error(tracenum, i, "realloc failed.");
+                return 0;
+            }
+
+            /* The block may have moved; its old contents must have come with it */
+            if (oldp != NULL)
+                remove_range(trace, index);
+            trace->blocks[index] = p;
+            trace->block_sizes[index] = size;
+            if (p == NULL)
+                break;
+            if (add_range(trace, index, p, size, tracenum, i) == 0)
+                return 0;
+            if (check_payload(trace, index, oldsize < size ? oldsize : size, tracenum, i) == 0)
+                return 0;
+            fill_payload(trace, index);
+            break;
+
+        case FREE: /* free */
+            /* The payload must be intact right up to the free */
+            if (trace->blocks[index] != NULL) {
+                if (check_payload(trace, index, trace->block_sizes[index], tracenum, i) == 0)
+                    return 0;
+                remove_range(trace, index);
+            }
+            f->free_fn(trace->blocks[index]);
+            trace->blocks[index] = NULL;
+            break;
+
+        default:
+            app_error("Nonexistent request type in eval_valid");
+        }
+    }
+
+    /* As far as we know, this is a valid malloc package */
+    return 1;
+}
+
+/*
+ * eval_mm_util - Evaluate the space utilization of the student's package. The idea is to remember the high water
+ *                mark "hwm" of the payload bytes in use at any one time and the largest footprint the allocator
+ *                took from the OS while serving the trace, and to return hwm/footprint
+ */
+static double eval_mm_util(trace_t *trace) {
+    size_t total_size = 0;
+    size_t max_total_size = 0;
+    size_t footprint = 0;
+    size_t size, newsize, oldsize;
+    char *p, *newp, *oldp;
+    int i, index;
+
+    /* Reset the heap and initialize the mm package */
+    mem_reset_brk();
+    if (mm_init() < 0)
+        app_error("mm_init failed in eval_mm_util");
+    memset(trace->blocks, 0, trace->num_ids * sizeof(char *));
+
+    for (i = 0; i < trace->num_ops; i++) {
+        switch (trace->ops[i].type) {
+        case ALLOC: /* mm_alloc */
+            index = trace->ops[i].index;
+            size = trace->ops[i].size;
+            if ((p = mm_malloc(size)) == NULL && size != 0)
+                app_error("mm_malloc failed in eval_mm_util");
+
+            /* Remember region and size */
+            trace->blocks[index] = p;
+            trace->block_sizes[index] = size;
+
+            /* Keep track of current total size of all allocated blocks */
+            total_size += size;
+            break;
+
+        case REALLOC: /* mm_realloc */
+            index = trace->ops[i].index;
+            newsize = trace->ops[i].size;
+            oldsize = trace->block_sizes[index];
+            oldp = trace->blocks[index];
+            if ((newp = mm_realloc(oldp, newsize)) == NULL && newsize != 0)
+                app_error("mm_realloc failed in eval_mm_util");
+
+            /* Remember region and size */
+            trace->blocks[index] = newp;
+            trace->block_sizes[index] = newsize;
+
+            /* Adjust current total size of all allocated blocks */
+            total_size += (newsize - oldsize);
+            break;
+
+        case FREE: /* mm_free */
+            index = trace->ops[i].index;
+            size = trace->block_sizes[index];
+            p = trace->blocks[index];
+            mm_free(p);
+            trace->blocks[index] = NULL;
+            trace->block_sizes[index] = 0;
+
+            /* Keep track of current total size of all allocated blocks */
+            total_size -= size;
+            break;
+
+        default:
+            app_error("Nonexistent request type in eval_mm_util");
+        }
+
+        /* Update statistics */
+        max_total_size = (total_size > max_total_size) ? total_size : max_total_size;
+        size = mm_footprint();
+        footprint = (size > footprint) ? size : footprint;
+    }
+    return footprint ? ((double)max_total_size / (double)footprint) : 0;
+}
+
+/*
+ * run_ops - Replay trace against the malloc package f with no checking. The run that is timed
+ */
+static void run_ops(trace_t *trace, funcs_t *f) {
+    char *p, *newp, *oldp;
+    int i, index;
+
+    if (f->reset) {
+        mem_reset_brk();
+        if (mm_init() < 0)
+            app_error("mm_init failed in run_ops");
+    }
+    for (i = 0; i < trace->num_ops; i++) {
+        index = trace->ops[i].index;
+        switch (trace->ops[i].type) {
+        case ALLOC: /* malloc */
+            if ((p = f->malloc_fn(trace->ops[i].size)) == NULL && trace->ops[i].size != 0)
+                app_error("malloc failed in run_ops");
+            trace->blocks[index] = p;
+            break;
+
+        case REALLOC: /* realloc */
+            oldp = trace->blocks[index];
+            if ((newp = f->realloc_fn(oldp, trace->ops[i].size)) == NULL && trace->ops[i].size != 0)
+                app_error("realloc failed in run_ops");
+            trace->blocks[index] = newp;
+            break;
+
+        case FREE: /* free */
+            f->free_fn(trace->blocks[index]);
+            trace->blocks[index] = NULL;
+            break;
+
+        default:
+            app_error("Nonexistent request type in run_ops");
+        }
+    }
+
+    /* Leave nothing behind for the next run (libc has no heap reset) */
+    for (i = 0; i < trace->num_ids; i++) {
+        if (trace->blocks[i] != NULL) {
+            f->free_fn(trace->blocks[i]);
+            trace->blocks[i] = NULL;
+        }
+    }
+}
+
+/*
+ * eval_speed - The function that is timed: one unchecked run of a trace
+ */
+static void eval_speed(void *ptr) {
+    speed_t *p = ptr;
+
+    run_ops(p->trace, p->funcs);
+}
+
+/*
+ * time_run - Return the time in seconds of one run of trace against f, as measured by fsecs
+ */
+static double time_run(trace_t *trace, funcs_t *f) {
+    speed_t params;
+
+    params.trace = trace;
+    params.funcs = f;
+    return fsecs(eval_speed, &params);
+}
+
+/*
+ * add_range - As directed by request opnum in trace tracenum, we've just called the student's malloc to allocate a
+ *             block of size bytes at addr lo. After checking the block for correctness, we create a range struct
+ *             for this block and add it to the range tree. Returns 1 if the block is valid, else 0
+ */
+static int add_range(trace_t *trace, int index, char *lo, size_t size, int tracenum, int opnum) {
+    char *hi = lo + size - 1;
+    range_t *r = &trace->ranges[index];
+    range_t *t;
+
+    /* Payload addresses must be ALIGNMENT-byte aligned */
+    if (!IS_ALIGNED(lo)) {
+        snprintf(msg, sizeof(msg), "Payload address (%p) not aligned to %d bytes", lo, ALIGNMENT);
+        malloc_error(tracenum, opnum, msg);
+        return 0;
+    }
+    if (size == 0)
+        hi = lo;
+
+    /* After splaying on lo the root is the live payload just below it, or the lowest one above it */
+    r->lo = lo;
+    r->hi = hi;
+    if ((t = range_root = splay(range_root, lo)) != NULL) {
+        if ((t->lo <= lo && t->hi >= lo) || (t->lo >= lo && t->lo <= hi)) {
+            snprintf(msg, sizeof(msg), "Payload (%p:%p) overlaps another payload (%p:%p)", lo, hi, t->lo, t->hi);
+            malloc_error(tracenum, opnum, msg);
+            return 0;
+        }
+        if (t->lo < lo) {
+            /* The next payload up is the smallest in the right subtree */
+            for (t = t->right; t != NULL && t->left != NULL; t = t->left)
+                ;
+        }
+        if (t != NULL && t->lo > lo && t->lo <= hi) {
+            snprintf(msg, sizeof(msg), "Payload (%p:%p) overlaps another payload (%p:%p)", lo, hi, t->lo, t->hi);
+            malloc_error(tracenum, opnum, msg);
+            return 0;
+        }
+    }
+
+    /* Everything looks OK, so insert r at the root */
+    t = range_root;
+    if (t == NULL) {
+        r->left = r->right = NULL;
+    }
+    else if (lo < t->lo) {
+        r->left = t->left;
+        r->right = t;
+        t->left = NULL;
+    }
+    else {
+        r->right = t->right;
+        r->left = t;
+        t->right = NULL;
+    }
+    range_root = r;
+    return 1;
+}
+
+/*
+ * remove_range - Free the range record of block index
+ */
+static void remove_range(trace_t *trace, int index) {
+    range_t *t = splay(range_root, trace->ranges[index].lo);
+
+    if (t->left == NULL) {
+        range_root = t->right;
+    }
+    else {
+        range_root = splay(t->left, t->lo);
+        range_root->right = t->right;
+    }
+}
+
+/*
+ * splay - Top-down splay of the range tree rooted at t on address lo. Returns the new root: the range starting at
+ *         lo if there is one, else a neighbour of lo
+ */
+static range_t *splay(range_t *t, char *lo) {
+    range_t n, *l, *r, *y;
+
+    if (t == NULL)
+        return t;
+    n.left = n.right = NULL;
+    l = r = &n;
+    for (;;) {
+        if (lo < t->lo) {
+            if (t->left == NULL)
+                break;
+            if (lo < t->left->lo) {
+                y = t->left;                  /* Rotate right */
+                t->left = y->right;
+                y->right = t;
+                t = y;
+                if (t->left == NULL)
+                    break;
+            }
+            r->left = t;                      /* Link right */
+            r = t;
+            t = t->left;
+        }
+        else if (lo > t->lo) {
+            if (t->right == NULL)
+                break;
+            if (lo > t->right->lo) {
+                y = t->right;                 /* Rotate left */
+                t->right = y->left;
+                y->left = t;
+                t = y;
+                if (t->right == NULL)
+                    break;
+            }
+            l->right = t;                     /* Link left */
+            l = t;
+            t = t->right;
+        }
+        else {
+            break;
+        }
+    }
+    l->right = t->left;                       /* Assemble */
+    r->left = t->right;
+    t->left = n.right;
+    t->right = n.left;
+    return t;
+}
+
+/*
+ * check_payload - Check that the first size bytes of block index still hold the pattern written when it was
+ *                 allocated. Returns 1 if they do, else 0
+ */
+static int check_payload(trace_t *trace, int index, size_t size, int tracenum, int opnum) {
+    char *p = trace->blocks[index];
+    size_t j;
+
+    for (j = 0; j < size; j++) {
+        if (p[j] != PATTERN(index, j)) {
+            snprintf(msg, sizeof(msg), "Payload of block %d (%p) was overwritten at offset %lu",
+                     index, p, (unsigned long)j);
+            malloc_error(tracenum, opnum, msg);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/*
+ * fill_payload - Write the pattern of block index over its whole payload
+ */
+static void fill_payload(trace_t *trace, int index) {
+    char *p = trace->blocks[index];
+    size_t j;
+
+    for (j = 0; j < trace->block_sizes[index]; j++)
+        p[j] = PATTERN(index, j);
+}
+
+/*
+ * printresults - prints a performance summary for some malloc package
+ */
+static void printresults(int n, stats_t *stats) {
+    double secs = 0;
+    double ops = 0;
+    double util = 0;
+    int i;
+
+    /* Print the individual results for each trace */
+    printf("%5s%7s %5s%8s%10s%8s\n", "trace", " valid", "util", "ops", "secs", "Kops");
+    for (i = 0; i < n; i++) {
+        if (stats[i].valid) {
+            printf("%2d%10s%5.0f%%%8.0f%10.6f%8.0f\n", i, "yes", stats[i].util * 100.0, stats[i].ops,
+                   stats[i].secs, stats[i].secs > 0 ? (stats[i].ops / 1e3) / stats[i].secs : 0);
+            secs += stats[i].secs;
+            ops += stats[i].ops;
+            util += stats[i].util;
+        }
+        else {
+            printf("%2d%10s%6s%8s%10s%8s\n", i, "no", "-", "-", "-", "-");
+        }
+    }
+
+    /* Print the aggregate results for the set of traces */
+    if (n > 0) {
+        printf("%12s%5.0f%%%8.0f%10.6f%8.0f\n", "Total       ", (util / n) * 100.0, ops, secs,
+               secs > 0 ? (ops / 1e3) / secs : 0);
+    }
+}
+
+/*
+ * malloc_error - Report an error returned by the malloc package
+ */
+static void malloc_error(int tracenum, int opnum, char *msg) {
+    printf("ERROR [trace %d, line %d]: %s\n", tracenum, LINENUM(opnum), msg);
+}
+
+/*
+ * usage - Explain the command line arguments
+ */
+static void usage(void) {
+    fprintf(stderr, "Usage: mdriver [-hvVl] [-f <file>] [-t <dir>]\n");
+    fprintf(stderr, "Options\n");
+    fprintf(stderr, "\t-f <file>  Use <file> as the trace file.\n");
+    fprintf(stderr, "\t-h         Print this message.\n");
+    fprintf(stderr, "\t-l         Run libc malloc as well.\n");
+    fprintf(stderr, "\t-t <dir>   Directory to find default traces.\n");
+    fprintf(stderr, "\t-v         Print per-trace performance breakdowns.\n");
+    fprintf(stderr, "\t-V         Print additional debug info.\n");
+}
@@ -10,6 +10,10 @@
  * because it allows us to interleave calls from the student's malloc
  * package with the system's malloc package in libc.
  *
+ * The heap is a large PROT_NONE reservation of address space. mem_sbrk
+ * makes pages accessible in chunks of the commit granularity as the
+ * break moves up, so an idle heap costs almost nothing and a busy one can
+ * grow as far as the reservation.
  */
 #include <stdio.h>
 #include <stdlib.h>
@@ -18,51 +22,127 @@
 #include <sys/mman.h>
 #include <string.h>
 #include <errno.h>
+#include <stdint.h>
 
 #include "config.h"
 #include "csapp.h"
 #include "memlib.h"
-#include "config.h"
 
 /* $begin memlib */
 /* Private global variables */
 static char *mem_heap;     /* Points to first byte of heap */
 static char *mem_brk;      /* Points to last byte of heap plus 1 */
 static char *mem_max_addr; /* Max legal heap addr plus 1*/
+static char *mem_commit;   /* End of the accessible part of the heap */
+static char *mem_top;      /* Highest break so far */
+static size_t mem_reserve = MEM_RESERVE;      /* Bytes reserved by mem_init */
+static size_t mem_granularity = MEM_COMMIT;   /* mem_sbrk commits in multiples of this */
 
 /*
  * mem_init - Initialize the memory system model
  */
 void mem_init(void)
 {
-    mem_heap = (char *)Malloc(MAX_HEAP);
+    mem_heap = (char *)Mmap(NULL, mem_reserve, PROT_NONE,
+                            MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
     mem_brk = (char *)mem_heap;
-    mem_max_addr = (char *)(mem_heap + MAX_HEAP);
+    mem_max_addr = (char *)(mem_heap + mem_reserve);
+    mem_commit = (char *)mem_heap;
+    mem_top = (char *)mem_heap;
+}
+/* $end memlib */
+
+/*
+ * mem_config - Set the number of bytes the next mem_init reserves and the
+ *    granularity in which mem_sbrk commits them, rounded up to whole
+ *    pages. A zero leaves that setting unchanged.
+ */
+void mem_config(size_t reserve, size_t granularity)
+{
+    size_t pagesize = mem_pagesize();
+
+    if (reserve)
+        mem_reserve = (reserve + pagesize - 1) & ~(pagesize - 1);
+    if (granularity)
+        mem_granularity = (granularity + pagesize - 1) & ~(pagesize - 1);
 }
+/* $begin memlib */
 
 /*
  * mem_sbrk - Simple model of the sbrk function. Extends the heap
- *    by incr bytes and returns the start address of the new area. In
- *    this model, the heap cannot be shrunk.
+ *    by incr bytes and returns the start address of the new area. A
+ *    negative incr shrinks the heap and gives the whole pages above
+ *    the new break back to the OS.
  */
-void *mem_sbrk(int incr)
+void *mem_sbrk(intptr_t incr)
 {
     char *old_brk = mem_brk;
-    if ( (incr < 0) || ((mem_brk + incr) > mem_max_addr)) {
+    char *new_commit;
+
+    if ( ((mem_brk + incr) < mem_heap) || ((mem_brk + incr) > mem_max_addr)) {
     	errno = ENOMEM;
     	fprintf(stderr, "ERROR: mem_sbrk failed. Ran out of memory...\n");
     	return (void *)-1;
     }
+
+    /* Make the pages under the new break accessible */
+    if (mem_brk + incr > mem_commit) {
+        new_commit = mem_heap + (mem_brk + incr - mem_heap + mem_granularity - 1)
+                                / mem_granularity * mem_granularity;
+        if (new_commit > mem_max_addr)
+            new_commit = mem_max_addr;
+        if (mprotect(mem_commit, new_commit - mem_commit, PROT_READ | PROT_WRITE) < 0) {
+            errno = ENOMEM;
+            fprintf(stderr, "ERROR: mem_sbrk failed. Could not commit memory...\n");
+            return (void *)-1;
+        }
+        mem_commit = new_commit;
+    }
     mem_brk += incr;
+    /* $end memlib */
+    if (incr < 0) {
+        mem_release(mem_brk, old_brk);
+    }
+    if (mem_brk > mem_top)
+        mem_top = mem_brk;
+    /* $begin memlib */
     return (void *)old_brk;
 }
 /* $end memlib */
 
+/*
+ * mem_release - Give the whole pages between lo and hi back to the OS. The
+ *    range stays mapped and reads as zeros the next time it is touched.
+ *    Returns the number of bytes released.
+ */
+size_t mem_release(void *lo, void *hi)
+{
+    size_t pagesize = mem_pagesize();
+    char *start = (char *)(((unsigned long)lo + pagesize - 1) & ~(pagesize - 1));
+    char *end = (char *)((unsigned long)hi & ~(pagesize - 1));
+
+    if (end <= start)
+        return 0;
+    madvise(start, end - start, MADV_DONTNEED);
+    return end - start;
+}
+
+/*
+ * mem_touched - return the highest break since mem_init. No byte at or
+ *    above it has been written, even if the break was reset or lowered.
+ */
+void *mem_touched()
+{
+    return (void *)mem_top;
+}
+
 /*
  * mem_deinit - free the storage used by the memory system model
  */
 void mem_deinit(void)
 {
+    Munmap(mem_heap, mem_max_addr - mem_heap);
+    mem_heap = mem_brk = mem_max_addr = mem_commit = mem_top = NULL;
 }
 
 /*
@@ -5,9 +5,14 @@
  * Cassie Liu       - 52504836
  */
 
+#include <stdint.h>
+
 void mem_init(void);
-void *mem_sbrk(int incr);
+void mem_config(size_t reserve, size_t granularity);
+void *mem_sbrk(intptr_t incr);
 void mem_deinit(void);
+size_t mem_release(void *lo, void *hi);
+void *mem_touched();
 void mem_reset_brk();
 void *mem_heap_lo();
 void *mem_heap_hi();
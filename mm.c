@@ -6,76 +6,415 @@
  */
 
 /*
- * Simple, 32-bit and 64-bit clean allocator based on implicit free
- * lists, first fit placement, and boundary tag coalescing, as described
- * in the CS:APP2e text. Blocks must be aligned to doubleword (8 byte)
- * boundaries. Minimum block size is 16 bytes.
+ * Simple, 32-bit and 64-bit clean allocator based on segregated explicit
+ * free lists, first fit placement within a size class, and boundary tag
+ * coalescing, as described in the CS:APP2e text. Free blocks are linked
+ * through the first two words of their payload, so a search only touches
+ * free blocks of a plausible size. Only free blocks carry a footer; each
+ * header records whether the previous block is allocated, so allocated
+ * blocks pay for a single header word. Words are 4 bytes, or 8 bytes
+ * when MM_WIDE_TAGS is set so that a single block can exceed 4 GB. Blocks
+ * must be aligned to doubleword boundaries. Minimum block size is MINBLOCK bytes
+ * (room for the header, footer and both free list links once freed).
+ * Requests of up to SLAB_MAX bytes bypass the boundary tag heap and are
+ * served from slabs: aligned pages cut into equal slots, with a bitmap of
+ * free slots and no per-object header. Requests of at least the mmap
+ * threshold get a private mapping that mm_free unmaps, so large buffers
+ * never grow the heap. A large free block at the top of a heap is trimmed
+ * off, and the pages inside free blocks are periodically given back to
+ * the OS. Small heap blocks can be freed lazily: they wait, still marked
+ * allocated, on per-size quick lists for the next request of their size
+ * and are coalesced in batches. Memory the heap has never written to is tracked (a header bit
+ * on free blocks, a high-water mark in each slab) so that mm_calloc only
+ * zeroes what may hold old data.
  */
+#define _GNU_SOURCE         /* For mremap */
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <errno.h>
+
+#include <sys/mman.h>
 
 #include "config.h"
 #include "mm.h"
 #include "memlib.h"
+#include "mmtrace.h"
+#if MM_THREADSAFE
+#include "csapp.h"
+#endif
 
 /* $begin mallocmacros */
 /* Basic constants and macros */
+#if MM_WIDE_TAGS
+typedef uint64_t tag_t;     /* Header/footer word */
+#define WSIZE       8       /* Word and header/footer size (bytes) */
+#define DSIZE       16      /* Doubleword size (bytes) */
+#else
+typedef unsigned int tag_t;
 #define WSIZE       4       /* Word and header/footer size (bytes) */ //line:vm:mm:beginconst
 #define DSIZE       8       /* Doubleword size (bytes) */
+#endif
 #define CHUNKSIZE  (1<<12)  /* Extend heap by this amount (bytes) */  //line:vm:mm:endconst
+#define PSIZE       (sizeof(void *))  /* Free list link size (bytes) */
+#define MINBLOCK    (DSIZE * ((DSIZE + 2*PSIZE + (DSIZE-1)) / DSIZE)) /* Minimum block size (bytes) */
+#define NUM_CLASSES 20      /* Number of segregated free list size classes */
+#define TCACHE_BINS 32      /* Per-thread cache bins, one per block size from SLAB_ALIGN in DSIZE steps */
+#define TCACHE_MAX  8       /* Blocks a thread may cache per bin before flushing half back to the heap */
+#define ZERO_RELEASE (1<<16) /* mm_calloc lets the OS zero the pages of a used block at least this large */
+#define TOP_PAD     (1<<16) /* Free bytes a trim first leaves at the top of a heap, so the next requests do not regrow it */
+#define TOP_PAD_MAX (1<<22) /* Largest the top pad grows to when trims keep being undone */
+#define QUICK_BINS  (MM_QUICK_MAX / DSIZE + 1)   /* One quick list per block size up to MM_QUICK_MAX */
+#define QUICK_LIMIT 256     /* Blocks an arena may hold on quick lists before they are all coalesced */
+#define POOL_SLAB   (1<<14) /* Bytes of objects in a pool slab */
+#define POOL_MIN    8       /* ... but room for at least this many objects */
 
 #define MAX(x, y) ((x) > (y)? (x) : (y))
+#define MIN(x, y) ((x) < (y)? (x) : (y))
+
+/* Adjusted block size for a request of size bytes: header plus payload, aligned, and at least MINBLOCK */
+#define ASIZE(size)  MAX(MINBLOCK, DSIZE * (((size) + (WSIZE) + (DSIZE-1)) / DSIZE))
+
+/* Slab constants */
+#define SLAB_SIZE   (1<<12)     /* Bytes per slab; slabs are aligned to this */
+#define SLAB_ALIGN  16          /* Slot sizes are multiples of this */
+#if MM_SLAB
+#define SLAB_MAX    256         /* Largest request served from a slab */
+#else
+#define SLAB_MAX    0
+#endif
+#define SLAB_CLASSES (256 / SLAB_ALIGN)           /* One slab list per slot size */
+#define SLAB_WORDS  (SLAB_SIZE / SLAB_ALIGN / 64) /* Bitmap words per slab */
+#define SLAB_ZONE   SLAB_RESERVE  /* Bytes of address space reserved for slabs */
+#define SLAB_CHUNK  (16*SLAB_SIZE)  /* Bytes of the slab zone an arena commits at a time */
+
+/* Slot size for a request of size bytes, and the block size the allocator hands out for it */
+#define SLAB_SLOT(size)   (SLAB_ALIGN * (((size) + (SLAB_ALIGN-1)) / SLAB_ALIGN))
+#define ALLOC_SIZE(size)  ((size) <= SLAB_MAX ? SLAB_SLOT(size) : ASIZE(size))
 
 /* Pack a size and allocated bit into a word */
 #define PACK(size, alloc)  ((size) | (alloc)) //line:vm:mm:pack
 
+/* Header bit recording that the previous block is allocated (and so has no footer) */
+#define PREV_ALLOC   0x2
+
+/* Header bit marking a block that has a mapping of its own; its size field is the length of the mapping */
+#define MMAPPED      0x4
+
+/*
+ * Header bit of a free heap block whose payload reads as zeros, apart from its free links and footer: it has never
+ * been written, or a release sweep gave its pages back. It shares its bit with MMAPPED, which only allocated blocks
+ * carry; any header rewrite drops it.
+ */
+#define CLEAN        0x4
+
 /* Read and write a word at address p */
-#define GET(p)       (*(unsigned int *)(p))            //line:vm:mm:get
-#define PUT(p, val)  (*(unsigned int *)(p) = (val))    //line:vm:mm:put
+#define GET(p)       (*(tag_t *)(p))                   //line:vm:mm:get
+#define PUT(p, val)  (*(tag_t *)(p) = (val))           //line:vm:mm:put
 
 /* Read the size and allocated fields from address p */
 #define GET_SIZE(p)  (GET(p) & ~0x7)                   //line:vm:mm:getsize
 #define GET_ALLOC(p) (GET(p) & 0x1)                    //line:vm:mm:getalloc
+#define GET_PREV_ALLOC(p) (GET(p) & PREV_ALLOC)
 
-/* Given block ptr bp, compute address of its header and footer */
+/* Largest size a header word can hold */
+#define MAX_BLOCK    ((size_t)(tag_t)~0x7)
+
+/* Given block ptr bp, compute address of its header and footer (free blocks only) */
 #define HDRP(bp)       ((char *)(bp) - WSIZE)                      //line:vm:mm:hdrp
 #define FTRP(bp)       ((char *)(bp) + GET_SIZE(HDRP(bp)) - DSIZE) //line:vm:mm:ftrp
 
-/* Given block ptr bp, compute address of next and previous blocks */
+/* Given block ptr bp, compute address of next and previous blocks (the previous block must be free) */
 #define NEXT_BLKP(bp)  ((char *)(bp) + GET_SIZE(((char *)(bp) - WSIZE))) //line:vm:mm:nextblkp
 #define PREV_BLKP(bp)  ((char *)(bp) - GET_SIZE(((char *)(bp) - DSIZE))) //line:vm:mm:prevblkp
 /* $end mallocmacros */
 
+/* Set or clear the prev-allocated bit in the header of block bp */
+#define SET_PREV_ALLOC(bp)  PUT(HDRP(bp), GET(HDRP(bp)) | PREV_ALLOC)
+#define CLR_PREV_ALLOC(bp)  PUT(HDRP(bp), GET(HDRP(bp)) & ~PREV_ALLOC)
+
+/* Given free block ptr bp, read and write its predecessor and successor links */
+#define PRED(bp)       (*(char **)(bp))
+#define SUCC(bp)       (*(char **)((char *)(bp) + PSIZE))
+
+/* In best fit mode the same two words hold the block's left and right children in the splay tree */
+#define LEFT(bp)       PRED(bp)
+#define RIGHT(bp)      SUCC(bp)
+
+/* Is bp inside the slab zone, and the slab that holds it */
+#define IN_SLAB(bp)  (slab_zone != NULL && (size_t)((char *)(bp) - slab_zone) < SLAB_ZONE)
+#define SLAB_OF(bp)  ((slab_t *)((unsigned long)(bp) & ~(unsigned long)(SLAB_SIZE-1)))
+
+/*
+ * A mapped block bp has its header in the word before it and, in the word before that, its offset from the start
+ * of the mapping. Slab objects have no header, so IS_MMAPPED rules them out first.
+ */
+#define IS_MMAPPED(bp)   (!IN_SLAB(bp) && (GET(HDRP(bp)) & MMAPPED))
+#define MMAP_BASE(bp)    ((char *)(bp) - GET((char *)(bp) - DSIZE))
+
+/* Order free block bp against the key (size, addr); ties on size are broken by address so keys are unique */
+#define KEY_CMP(size, addr, bp) \
+    ((size) != GET_SIZE(HDRP(bp)) ? ((size) < GET_SIZE(HDRP(bp)) ? -1 : 1) : \
+     ((char *)(addr) != (char *)(bp) ? ((char *)(addr) < (char *)(bp) ? -1 : 1) : 0))
+
+typedef struct slab slab_t;
+
+/*
+ * An arena is an independent heap with its own free index and lock. Arena 0 is the main arena and grows through
+ * mem_sbrk; in the thread-safe build the others each reserve a private MAX_HEAP region the first time they are used
+ * and grow through arena_sbrk. Threads are assigned arenas round robin and move to an idle arena when theirs is
+ * contended; a block is always freed back to the arena whose region holds it.
+ */
+typedef struct {
+    char *heap_listp;                 /* Pointer to first block, 0 until the arena's heap is created */
+    char *free_lists[NUM_CLASSES];    /* Heads of the segregated free lists */
+    char *free_tree;                  /* Root of the best fit splay tree */
+    char *rover;                      /* Next fit rover */
+    char *quick[QUICK_BINS];          /* Quick lists of blocks freed but not yet coalesced, indexed by size/DSIZE */
+    int quick_count;                  /* Blocks on all quick lists */
+    char *lo;                         /* Private region of a secondary arena: first byte, */
+    char *brk;                        /* current break, */
+    char *max;                        /* and end of the reservation */
+    char *touched;                    /* Highest break so far; nothing above it has been written */
+    slab_t *slabs[SLAB_CLASSES];      /* Slabs with a free slot, one list per slot size */
+    slab_t *slab_empty;               /* Slabs with no objects, kept for reuse by any size */
+    char *slab_next;                  /* Committed part of the slab zone not yet cut into slabs, */
+    char *slab_end;                   /* and its end */
+    size_t free_bytes;                /* Bytes in blocks on the free index */
+    size_t free_low;                  /* Lowest free_bytes since the last release sweep, less fresh heap */
+    size_t top_pad;                   /* Free bytes a trim leaves at the top; doubles when the heap regrows */
+    int trimmed;                      /* Set if heap_free trimmed the heap since it last grew */
+    int fresh;                        /* Set if the block heap_malloc just returned has never been written */
+    mm_stats_t stats;                 /* Counters reported by mm_getstats */
+#if MM_THREADSAFE
+    sem_t mutex;                      /* Guards everything above */
+#endif
+} arena_t;
+
+/*
+ * A slab is a SLAB_SIZE page in the slab zone. The header below sits at the start of the page and the slots follow
+ * at SLAB_HDR. A set bit in map marks a free slot; a slab leaves its arena's list when it fills up and rejoins it on
+ * the next free. Objects carry no header: mm_free recognises a slab object by its address and finds the slab by
+ * rounding down.
+ */
+struct slab {
+    slab_t *next;                     /* Links on the arena's list for this slot size */
+    slab_t *prev;
+    void *ar;                         /* Arena that owns the slab */
+    unsigned int size;                /* Slot size (bytes) */
+    unsigned int nslots;              /* Number of slots */
+    unsigned int nfree;               /* Number of free slots */
+    unsigned int used;                /* Slots from here on have never been handed out */
+    unsigned long long map[SLAB_WORDS];
+};
+
+#define SLAB_HDR    (SLAB_ALIGN * ((sizeof(slab_t) + (SLAB_ALIGN-1)) / SLAB_ALIGN))
+
+/*
+ * An object pool hands out objects of one size from pool slabs: large blocks taken from the main arena's heap. A
+ * freed object goes on the pool's free list, linked through its first word, and is reused last in, first out; the
+ * untouched tail of the newest slab is carved on demand. Slabs go back to the heap only when the pool is destroyed.
+ * Each pool has its own lock and takes the main arena's lock only to get a slab.
+ */
+struct mm_pool {
+    mm_pool_t *next;                  /* Live pools, for mm_getstats */
+    mm_pool_t *prev;
+    char *free;                       /* Freed objects */
+    size_t nfree;                     /* Objects on the free list */
+    char *bump;                       /* Next object never handed out in the newest slab, */
+    char *end;                        /* and the end of its objects */
+    char *slabs;                      /* Slabs, linked through their first word */
+    size_t objsize;                   /* Object size (bytes), a multiple of align */
+    size_t align;                     /* Object alignment, a power of two */
+    unsigned long allocs;             /* Counters reported by mm_getstats */
+    unsigned long frees;
+    unsigned long nslabs;
+#if MM_THREADSAFE
+    sem_t mutex;                      /* Guards everything above but the links */
+#endif
+};
+
+#if MM_THREADSAFE
+#define NARENAS     MM_ARENAS
+#else
+#define NARENAS     1
+#endif
+
 /* Global variables */
-static char *heap_listp = 0;  /* Pointer to first block */
-static unsigned int numberOfBlocks = 0;
-static void *blockArray[1000];
+static arena_t arenas[NARENAS];
+
+/*
+ * Block handles name allocated blocks by small integers for the shell. handles[h] holds the block with handle h; a
+ * free slot instead holds the next free slot's index shifted left with the low bit set, which no block pointer has.
+ * Freed handles are reused last in, first out, and slot 0 is never used so handles start at 1.
+ */
+static uintptr_t *handles;
+static int handle_cap;                     /* Slots in handles */
+static int handle_top = 1;                 /* Slots below this have been handed out */
+static int handle_free;                    /* Most recently freed slot, 0 if none */
+static char *slab_zone;                    /* Reserved on first use; never moves or shrinks */
+static size_t slab_top;                    /* Bytes of the slab zone committed so far */
+static size_t slab_bytes;                  /* ... and cut into slabs */
+static size_t mmap_bytes;                  /* Bytes in mapped blocks */
+/* Thresholds set with mm_setopt; (size_t)-1 turns one off, and a default of 0 starts it off */
+static size_t mmap_threshold = MM_MMAP_THRESHOLD ? MM_MMAP_THRESHOLD : (size_t)-1;
+static size_t trim_threshold = MM_TRIM_THRESHOLD ? MM_TRIM_THRESHOLD : (size_t)-1;
+static size_t release_threshold = MM_RELEASE_THRESHOLD ? MM_RELEASE_THRESHOLD : (size_t)-1;
+static size_t quick_max = MM_QUICK_MAX;    /* Set with mm_setopt; largest block size put on a quick list */
+static mm_pool_t *pools;                   /* Live pools; mm_init discards them with the heap */
+
+/*
+ * Placement policy, selected at runtime with mm_set_policy. MM_FIRSTFIT and MM_NEXTFIT walk the implicit block
+ * list and keep no free index; MM_SEGFIT keeps free_lists and MM_BESTFIT keeps free_tree.
+ */
+static int fit_policy = MM_SEGFIT;
 
+#if MM_THREADSAFE
 /*
- * If NEXT_FIT defined use next fit search, else use first fit search (this is defined or undefined in shellex.c in the
- * builtin_command function. Macros are declared as global (<--- I think they are, need more research -Ian)
+ * Thread-safe mode. Each arena's state is guarded by its own mutex. Small blocks are also cached per thread: a
+ * cached block stays marked allocated in its arena and is linked through its first payload word, so the fast path
+ * of mm_malloc and mm_free takes no lock. Only refilling an empty bin or flushing a full one takes an arena lock.
  */
-#ifdef NEXT_FIT
-static char *rover;           /* Next fit rover */
+static pthread_once_t heap_once = PTHREAD_ONCE_INIT;
+static pthread_key_t tcache_key;           /* Only used to flush a thread's cache when it exits */
+static unsigned long heap_generation;      /* Bumped by mm_init so caches holding blocks of an old heap drop them */
+static unsigned int next_arena;            /* Round robin arena assignment */
+
+static __thread char *tcache[TCACHE_BINS];
+static __thread int tcache_count[TCACHE_BINS];
+static __thread unsigned long tcache_generation;
+static __thread arena_t *thread_arena;     /* Arena this thread allocates from */
+static sem_t handle_mutex;                 /* Guards the handle table */
+static sem_t pool_mutex;                   /* Guards the list of pools */
+
+static void heap_once_init(void);
+static void *tcache_get(size_t asize);
+static int tcache_put(void *bp);
+static void tcache_flush(int bin, int count);
+static void tcache_destroy(void *unused);
+static void fork_prepare(void);
+static void fork_release(void);
+
+#define LOCK(ar)    (Pthread_once(&heap_once, heap_once_init), P(&(ar)->mutex))
+#define UNLOCK(ar)  V(&(ar)->mutex)
+#define HANDLE_LOCK()    (Pthread_once(&heap_once, heap_once_init), P(&handle_mutex))
+#define HANDLE_UNLOCK()  V(&handle_mutex)
+#define POOLS_LOCK()     (Pthread_once(&heap_once, heap_once_init), P(&pool_mutex))
+#define POOLS_UNLOCK()   V(&pool_mutex)
+#else
+#define LOCK(ar)
+#define UNLOCK(ar)
+#define HANDLE_LOCK()
+#define HANDLE_UNLOCK()
+#define POOLS_LOCK()
+#define POOLS_UNLOCK()
 #endif
 
 /* Function prototypes for internal helper routines */
-static void *extend_heap(size_t words);
-static void place(void *bp, size_t asize);
-static void *find_fit(size_t asize);
-static void *coalesce(void *bp);
-static void printblock(void *bp);
-static void checkheap(int verbose);
+static void *malloc_block(size_t size);
+static void free_block(void *bp);
+static void *realloc_block(void *ptr, size_t size);
+static void *calloc_block(size_t size);
+static void zero_block(char *bp, size_t size);
+static void *memalign_block(size_t align, size_t size);
+static size_t malloc_batch(size_t size, size_t count, void **out);
+static int addr_cmp(const void *a, const void *b);
+static arena_t *arena_get(void);
+static arena_t *arena_of(void *bp);
+static void *arena_sbrk(arena_t *ar, intptr_t incr);
+static char *arena_touched(arena_t *ar);
+static size_t trim_top(arena_t *ar, size_t pad);
+static void release_free(arena_t *ar);
+static void *slab_malloc(arena_t *ar, size_t size);
+static void slab_free(arena_t *ar, void *bp);
+static slab_t *slab_new(arena_t *ar, size_t size);
+static int pool_grow(mm_pool_t *p, size_t count);
+static void *mmap_malloc(size_t size, size_t align);
+static void *mmap_realloc(void *bp, size_t size);
+static void mmap_free(void *bp);
+static size_t payload_size(void *bp);
+static int grow_handles(void);
+static int init_heap(arena_t *ar);
+static void *heap_malloc(arena_t *ar, size_t asize);
+static void *heap_memalign(arena_t *ar, size_t align, size_t asize);
+static size_t heap_malloc_batch(arena_t *ar, size_t asize, size_t count, void **out);
+static void heap_free(arena_t *ar, void *bp);
+static void *extend_heap(arena_t *ar, size_t words);
+static void place(arena_t *ar, void *bp, size_t asize);
+static void shrink_block(arena_t *ar, void *bp, size_t asize);
+static int grow_in_place(arena_t *ar, void *bp, size_t asize);
+static void *find_fit(arena_t *ar, size_t asize);
+static void *find_free(arena_t *ar, size_t asize);
+static void consolidate(arena_t *ar);
+static void *coalesce(arena_t *ar, void *bp);
+static int size_class(size_t asize);
+static void insert_free(arena_t *ar, void *bp);
+static void remove_free(arena_t *ar, void *bp);
+static void rebuild_free_index(arena_t *ar);
+static char *splay(char *t, size_t size, char *addr);
+static int checktree(char *t);
+static void printblock(arena_t *ar, void *bp);
+static void checkheap(arena_t *ar, int verbose);
 static void checkblock(void *bp);
+static void checkslabs(arena_t *ar);
 
 /*
- * mm_init - Initialize the memory manager
+ * mm_init - Initialize the memory manager. The main arena gets a fresh heap at the current break; secondary arenas
+ *           are emptied and recreate their heaps the next time they are used. All slabs, handles and pools are
+ *           discarded.
  */
-/* $begin mminit */
 int mm_init(void) {
+    arena_t *ar;
+    int i, ret;
+
+    for (i = NARENAS - 1; i > 0; i--) {
+        ar = &arenas[i];
+        LOCK(ar);
+        ar->heap_listp = 0;
+        ar->brk = ar->lo;
+        memset(ar->slabs, 0, sizeof(ar->slabs));
+        ar->slab_empty = NULL;
+        ar->slab_next = ar->slab_end = NULL;
+        UNLOCK(ar);
+    }
+    HANDLE_LOCK();
+    handle_top = 1;
+    handle_free = 0;
+    HANDLE_UNLOCK();
+    POOLS_LOCK();
+    pools = NULL;
+    POOLS_UNLOCK();
+    
+    ar = &arenas[0];
+    LOCK(ar);
+    memset(ar->slabs, 0, sizeof(ar->slabs));
+    ar->slab_empty = NULL;
+    ar->slab_next = ar->slab_end = NULL;
+    
+    /* Release the used part of the slab zone too, so every slab starts out untouched again */
+    if (slab_zone != NULL) {
+        mem_release(slab_zone, slab_zone + MIN(slab_top, SLAB_ZONE));
+    }
+    slab_top = 0;
+    slab_bytes = 0;
+    ret = init_heap(ar);
+#if MM_THREADSAFE
+    heap_generation++;
+#endif
+    UNLOCK(ar);
+    return ret;
+}
+
+/*
+ * init_heap - Create an empty heap in arena ar. Called with the arena lock held
+ */
+/* $begin mminit */
+static int init_heap(arena_t *ar) {
+    int i;
+
     /* Create the initial empty heap */
-    if ((heap_listp = mem_sbrk(4*WSIZE)) == (void *)-1) { //line:vm:mm:begininit
+    if ((ar->heap_listp = arena_sbrk(ar, 4*WSIZE)) == (void *)-1) { //line:vm:mm:begininit
         return -1;
     }
     
@@ -83,29 +422,39 @@ int mm_init(void) {
      * Creates the special prologue block (only header and footer with 8 bytes each-- no payload) that never get freed
      * from the heap. Marks the beginning of the heap.
      */
-    PUT(heap_listp, 0);                          /* Alignment padding */
-    PUT(heap_listp + (1*WSIZE), PACK(DSIZE, 1)); /* Prologue header */
-    PUT(heap_listp + (2*WSIZE), PACK(DSIZE, 1)); /* Prologue footer */
+    PUT(ar->heap_listp, 0);                          /* Alignment padding */
+    PUT(ar->heap_listp + (1*WSIZE), PACK(DSIZE, 1)); /* Prologue header */
+    PUT(ar->heap_listp + (2*WSIZE), PACK(DSIZE, 1)); /* Prologue footer */
     
     /*
      * Creates the special epilogue block header that marks the end of the heap. All blocks between the prologue block
      * and epilogue block are considered the heap.
      */
-    PUT(heap_listp + (3*WSIZE), PACK(0, 1));     /* Epilogue header */
+    PUT(ar->heap_listp + (3*WSIZE), PACK(0, 1) | PREV_ALLOC); /* Epilogue header */
     
     /*
      * Always points to the prologue block. The end of the prologue block is the start of the heap.
      */
-    heap_listp += (2*WSIZE);                     //line:vm:mm:endinit
+    ar->heap_listp += (2*WSIZE);                     //line:vm:mm:endinit
     /* $end mminit */
 
-    #ifdef NEXT_FIT
-        rover = heap_listp;
-    #endif
+    /* Every free list starts out empty; extend_heap seeds the first block */
+    for (i = 0; i < NUM_CLASSES; i++) {
+        ar->free_lists[i] = NULL;
+    }
+
+    ar->free_tree = NULL;
+    ar->rover = ar->heap_listp;
+    ar->free_bytes = ar->free_low = 0;
+    ar->top_pad = TOP_PAD;
+    ar->trimmed = 0;
+    memset(&ar->stats, 0, sizeof(ar->stats));
+    memset(ar->quick, 0, sizeof(ar->quick));
+    ar->quick_count = 0;
     /* $begin mminit */
 
     /* Extend the empty heap with a free block of CHUNKSIZE bytes */
-    if (extend_heap(CHUNKSIZE/WSIZE) == NULL) {
+    if (extend_heap(ar, CHUNKSIZE/WSIZE) == NULL) {
         return -1;
     }
     return 0;
@@ -115,275 +464,1097 @@ int mm_init(void) {
 /*
  * mm_malloc - Allocate a block with at least size bytes of payload
  */
-/* $begin mmmalloc */
 void *mm_malloc(size_t size) {
-    size_t extendsize; /* Amount to extend heap if no fit */
+    void *bp = malloc_block(size);
+
+    TRACE(MM_TRACE_MALLOC, bp, size, NULL);
+    return bp;
+}
+
+/*
+ * malloc_block - Allocate a block with at least size bytes of payload from a mapping, the thread's cache or an arena
+ */
+static void *malloc_block(size_t size) {
+    size_t asize;      /* Adjusted block size */
+    arena_t *ar;
     char *bp;
 
-	/* $end mmmalloc */
-    if (heap_listp == 0) {
-		mm_init();
-    }
-	/* $begin mmmalloc */
     /* Ignore spurious requests */
     if (size == 0) {
 		return NULL;
 	}
+    
+    if (size >= mmap_threshold) {
+        return mmap_malloc(size, DSIZE);
+    }
+    
+    /* The block size must fit in a header */
+    if (size > MAX_BLOCK - DSIZE) {
+        return NULL;
+    }
+
+    /* Adjust block size to include overhead and alignment reqs, or round up to a slab slot */
+    asize = ALLOC_SIZE(size);
+
+#if MM_THREADSAFE
+    if ((bp = tcache_get(asize)) != NULL) {
+        return bp;
+    }
+#endif
+    ar = arena_get();
+    bp = heap_malloc(ar, asize);
+    UNLOCK(ar);
+    
+    /* A secondary arena's region is full; fall back to the main arena, which can grow to the whole heap */
+    if (bp == NULL && ar != &arenas[0]) {
+        ar = &arenas[0];
+        LOCK(ar);
+        bp = heap_malloc(ar, asize);
+        UNLOCK(ar);
+    }
+    return bp;
+}
+
+/*
+ * heap_malloc - Allocate a block of asize bytes from arena ar, from a slab if asize is a slot size. Called with the
+ *               arena lock held
+ */
+/* $begin mmmalloc */
+static void *heap_malloc(arena_t *ar, size_t asize) {
+    size_t extendsize; /* Amount to extend heap if no fit */
+    char *bp;
 
-    /* Search the free list for a fit */
-    if ((bp = find_fit(size)) != NULL) {  //line:vm:mm:findfitcall
-		place(bp, size);                  //line:vm:mm:findfitplace
-		numberOfBlocks++;
-		blockArray[numberOfBlocks] = bp;
-		printf("%d\n", numberOfBlocks);
+	/* $end mmmalloc */
+    if (asize <= SLAB_MAX) {
+        if ((bp = slab_malloc(ar, asize)) != NULL) {
+            return bp;
+        }
+        asize = ASIZE(asize);   /* The slab zone is used up; the heap serves the slot size instead */
+    }
+    if (ar->heap_listp == 0) {
+		init_heap(ar);
+    }
+    
+    /* A block of exactly this size freed recently is reused as it is */
+    if (asize <= quick_max && asize / DSIZE < QUICK_BINS && (bp = ar->quick[asize / DSIZE]) != NULL) {
+        ar->quick[asize / DSIZE] = PRED(bp);
+        ar->quick_count--;
+        ar->fresh = 0;
+        ar->stats.quick_hits++;
+        return bp;
+    }
+	/* $begin mmmalloc */
+    /* Search the free lists for a fit */
+    if ((bp = find_free(ar, asize)) != NULL) {  //line:vm:mm:findfitcall
+		place(ar, bp, asize);                  //line:vm:mm:findfitplace
 		return bp;
     }
     
     /* No fit found. Get more memory and place the block */
-    extendsize = MAX(size,CHUNKSIZE);                 //line:vm:mm:growheap1
-    if ((bp = extend_heap(extendsize/WSIZE)) == NULL) {
+    extendsize = MAX(asize,CHUNKSIZE);                 //line:vm:mm:growheap1
+    if ((bp = extend_heap(ar, extendsize/WSIZE)) == NULL) {
 		return NULL;                                  //line:vm:mm:growheap2
 	}
-	place(bp, size);
-	numberOfBlocks++;
-	blockArray[numberOfBlocks] = bp;
-	printf("%d\n", numberOfBlocks);
+	place(ar, bp, asize);
     return bp;
 }
 /* $end mmmalloc */
 
+/*
+ * heap_memalign - Allocate a block of asize bytes whose payload is aligned to align from arena ar's heap, never from
+ *                 a slab. A block with room for the payload at any alignment is placed, then the gap in front of
+ *                 the aligned payload and the tail behind it are split off and freed. Called with the arena lock held
+ */
+static void *heap_memalign(arena_t *ar, size_t align, size_t asize) {
+    size_t size = asize + align + MINBLOCK;
+    size_t csize, gap;
+    char *bp, *abp;
+
+    if (ar->heap_listp == 0) {
+        init_heap(ar);
+    }
+    if ((bp = find_free(ar, size)) == NULL && (bp = extend_heap(ar, MAX(size, CHUNKSIZE)/WSIZE)) == NULL) {
+        return NULL;
+    }
+    place(ar, bp, size);
+    
+    /* The gap must be empty or large enough to be a free block of its own */
+    abp = (char *)(((uintptr_t)bp + align - 1) & ~(uintptr_t)(align - 1));
+    while (abp != bp && (size_t)(abp - bp) < MINBLOCK) {
+        abp += align;
+    }
+    if (abp != bp) {
+        gap = abp - bp;
+        csize = GET_SIZE(HDRP(bp));
+        PUT(HDRP(abp), PACK(csize - gap, 1));
+        PUT(HDRP(bp), PACK(gap, 0) | GET_PREV_ALLOC(HDRP(bp)));
+        PUT(FTRP(bp), PACK(gap, 0));
+        coalesce(ar, bp);
+        bp = abp;
+    }
+    shrink_block(ar, bp, asize);
+    return bp;
+}
+
+/*
+ * heap_malloc_batch - Allocate up to count blocks of asize bytes from arena ar into out. Heap blocks are carved
+ *                     side by side from one free block large enough for all of them when there is one, extending
+ *                     the heap by the whole amount otherwise. Returns the number allocated. Called with the arena
+ *                     lock held
+ */
+static size_t heap_malloc_batch(arena_t *ar, size_t asize, size_t count, void **out) {
+    size_t n = 0;
+    size_t k, csize;
+    char *bp;
+
+    if (asize <= SLAB_MAX) {
+        for (; n < count && (out[n] = slab_malloc(ar, asize)) != NULL; n++) {
+            ;
+        }
+        if (n == count) {
+            return n;
+        }
+        asize = ASIZE(asize);   /* The slab zone is used up; carve the rest from the heap */
+    }
+    if (ar->heap_listp == 0) {
+        init_heap(ar);
+    }
+    while (n < count) {
+        k = MIN(count - n, MAX_BLOCK / asize);
+        
+        /* Failing a region for all k, use up a free block that holds at least one before growing the heap */
+        if ((bp = find_fit(ar, k * asize)) == NULL && (bp = find_free(ar, asize)) == NULL &&
+            (bp = extend_heap(ar, MAX(k * asize, CHUNKSIZE)/WSIZE)) == NULL) {
+            break;
+        }
+        k = MIN(k, GET_SIZE(HDRP(bp)) / asize);
+        place(ar, bp, k * asize);
+        
+        /* Cut the placed block into k blocks; the last one keeps any slack place left behind */
+        csize = GET_SIZE(HDRP(bp));
+        for (; k > 1; k--) {
+            PUT(HDRP(bp), PACK(asize, 1) | GET_PREV_ALLOC(HDRP(bp)));
+            out[n++] = bp;
+            bp += asize;
+            csize -= asize;
+            PUT(HDRP(bp), PACK(csize, 1) | PREV_ALLOC);
+        }
+        out[n++] = bp;
+    }
+    return n;
+}
+
 /*
  * mm_free - Free a block
  */
-/* $begin mmfree */
 void mm_free(void *bp) {
-    /* $end mmfree */
+    TRACE(MM_TRACE_FREE, bp, 0, NULL);
+    free_block(bp);
+}
+
+/*
+ * free_block - Free a block back to its mapping, the thread's cache or the arena that owns it
+ */
+static void free_block(void *bp) {
+    arena_t *ar;
+
     if(bp == 0) {
         return;
     }
-    
+    if (IS_MMAPPED(bp)) {
+        mmap_free(bp);
+        return;
+    }
+#if MM_THREADSAFE
+    if (tcache_put(bp)) {
+        return;
+    }
+#endif
+    ar = arena_of(bp);
+    LOCK(ar);
+    heap_free(ar, bp);
+    UNLOCK(ar);
+}
+
+/*
+ * heap_free - Return a block, or a slab object, to arena ar. Called with the arena lock held
+ */
+/* $begin mmfree */
+static void heap_free(arena_t *ar, void *bp) {
+    size_t size;
+
+    /* $end mmfree */
+    if (IN_SLAB(bp)) {
+        slab_free(ar, bp);
+        return;
+    }
     /* $begin mmfree */
-    size_t size = GET_SIZE(HDRP(bp));
+    size = GET_SIZE(HDRP(bp));
     /* $end mmfree */
-    if (heap_listp == 0) {
-        mm_init();
+    
+    /* Defer coalescing a small block: it stays marked allocated on the quick list for its size */
+    if (size <= quick_max) {
+        PRED(bp) = ar->quick[size / DSIZE];
+        ar->quick[size / DSIZE] = bp;
+        if (++ar->quick_count >= QUICK_LIMIT) {
+            consolidate(ar);
+        }
+        return;
     }
     /* $begin mmfree */
-    PUT(HDRP(bp), PACK(size, 0));
+
+    PUT(HDRP(bp), PACK(size, 0) | GET_PREV_ALLOC(HDRP(bp)));
     PUT(FTRP(bp), PACK(size, 0));
-    coalesce(bp);
+    CLR_PREV_ALLOC(NEXT_BLKP(bp));
+    bp = coalesce(ar, bp);
+    /* $end mmfree */
+    
+    /*
+     * Shrink the heap under a large free top block, keeping a pad for the next requests. Once free memory has grown
+     * by release_threshold over its lowest point since the last sweep, release the pages inside free blocks
+     */
+    if (GET_SIZE(HDRP(NEXT_BLKP(bp))) == 0 && GET_SIZE(HDRP(bp)) >= trim_threshold && trim_top(ar, ar->top_pad)) {
+        ar->trimmed = 1;
+    }
+    if (ar->free_bytes - ar->free_low >= release_threshold) {
+        release_free(ar);
+    }
+    /* $begin mmfree */
 }
 /* $end mmfree */
 /*
- * coalesce - Boundary tag coalescing. Return ptr to coalesced block
+ * coalesce - Boundary tag coalescing. Unlinks any free neighbours from
+ *            their free lists and links the merged block into the list for
+ *            its new size. Return ptr to coalesced block
  */
 /* $begin mmfree */
-static void *coalesce(void *bp) {
-    size_t prev_alloc = GET_ALLOC(FTRP(PREV_BLKP(bp)));
+static void *coalesce(arena_t *ar, void *bp) {
+    size_t prev_alloc = GET_PREV_ALLOC(HDRP(bp));
     size_t next_alloc = GET_ALLOC(HDRP(NEXT_BLKP(bp)));
     size_t size = GET_SIZE(HDRP(bp));
     
     if (prev_alloc && next_alloc) {            /* Case 1 */
+        insert_free(ar, bp);
         return bp;
     }
     
     else if (prev_alloc && !next_alloc) {      /* Case 2 */
+		remove_free(ar, NEXT_BLKP(bp));
 		size += GET_SIZE(HDRP(NEXT_BLKP(bp)));
-		PUT(HDRP(bp), PACK(size, 0));
+		PUT(HDRP(bp), PACK(size, 0) | PREV_ALLOC);
 		PUT(FTRP(bp), PACK(size,0));
     }
     
     else if (!prev_alloc && next_alloc) {      /* Case 3 */
+		remove_free(ar, PREV_BLKP(bp));
 		size += GET_SIZE(HDRP(PREV_BLKP(bp)));
 		PUT(FTRP(bp), PACK(size, 0));
-		PUT(HDRP(PREV_BLKP(bp)), PACK(size, 0));
+		PUT(HDRP(PREV_BLKP(bp)), PACK(size, 0) | PREV_ALLOC);
 		bp = PREV_BLKP(bp);
     }
     
     else {                                     /* Case 4 */
-        size += GET_SIZE(HDRP(PREV_BLKP(bp))) + GET_SIZE(FTRP(NEXT_BLKP(bp)));
-        PUT(HDRP(PREV_BLKP(bp)), PACK(size, 0));
+        remove_free(ar, PREV_BLKP(bp));
+        remove_free(ar, NEXT_BLKP(bp));
+        size += GET_SIZE(HDRP(PREV_BLKP(bp))) + GET_SIZE(HDRP(NEXT_BLKP(bp)));
+        PUT(HDRP(PREV_BLKP(bp)), PACK(size, 0) | PREV_ALLOC);
         PUT(FTRP(NEXT_BLKP(bp)), PACK(size, 0));
         bp = PREV_BLKP(bp);
     }
-    /* $end mmfree */
-#ifdef NEXT_FIT
+    insert_free(ar, bp);
+
     /* Make sure the rover isn't pointing into the free block */
     /* that we just coalesced */
-    if ((rover > (char *)bp) && (rover < NEXT_BLKP(bp))) {
-        rover = bp;
+    if ((ar->rover > (char *)bp) && (ar->rover < NEXT_BLKP(bp))) {
+        ar->rover = bp;
     }
-#endif
-    /* $begin mmfree */
     return bp;
 }
 /* $end mmfree */
 
 /*
- * mm_realloc - Naive implementation of realloc
+ * mm_realloc - Resize a block, keeping its contents
  */
 void *mm_realloc(void *ptr, size_t size) {
-    size_t oldsize;
+    void *newptr;
+
+    TRACE_REALLOC_BEGIN(ptr);
+    newptr = realloc_block(ptr, size);
+    TRACE(MM_TRACE_REALLOC, newptr, size, ptr);
+    return newptr;
+}
+
+/*
+ * realloc_block - Resize a block in place when possible. A shrink splits off the tail as a free block; a grow
+ *                 absorbs a free successor, extending the heap first when the block is the last one. A slab object
+ *                 stays put while the new size fits its slot, and a mapped block that stays large has its mapping
+ *                 resized, which moves pages rather than bytes. Otherwise it falls back to allocate, copy and free.
+ */
+static void *realloc_block(void *ptr, size_t size) {
+    size_t oldsize, asize;
+    arena_t *ar;
     void *newptr;
     
     /* If size == 0 then this is just free, and we return NULL. */
     if (size == 0) {
-        mm_free(ptr);
+        free_block(ptr);
         return 0;
     }
     
     /* If oldptr is NULL, then this is just malloc. */
     if (ptr == NULL) {
-        return mm_malloc(size);
+        return malloc_block(size);
+    }
+    if (size > MAX_BLOCK - DSIZE) {
+        return NULL;
     }
     
-    newptr = mm_malloc(size);
+    /* A mapped block belongs to no arena; it only moves into the heap when it shrinks below the mmap threshold */
+    if (IS_MMAPPED(ptr)) {
+        if (size >= mmap_threshold) {
+            return mmap_realloc(ptr, size);
+        }
+        if ((newptr = malloc_block(size)) != NULL) {
+            memcpy(newptr, ptr, MIN(size, payload_size(ptr)));
+            mmap_free(ptr);
+            __sync_fetch_and_add(&arenas[0].stats.realloc_copy, 1);
+        }
+        return newptr;
+    }
     
-    /* If realloc() fails the original block is left untouched  */
-    if (!newptr) {
-        return 0;
+    /* The block is resized, or its replacement allocated, in the arena that owns it */
+    ar = arena_of(ptr);
+    LOCK(ar);
+    
+    if (IN_SLAB(ptr)) {
+        /* Keep the slot if the new size still fits */
+        if (size <= payload_size(ptr)) {
+            ar->stats.realloc_shrink++;
+            UNLOCK(ar);
+            return ptr;
+        }
+    }
+    else {
+        asize = ASIZE(size);
+        oldsize = GET_SIZE(HDRP(ptr));
+        
+        /* Shrink (or same size) in place */
+        if (asize <= oldsize) {
+            shrink_block(ar, ptr, asize);
+            ar->stats.realloc_shrink++;
+            UNLOCK(ar);
+            return ptr;
+        }
+        
+        /* Grow in place into the next block or the end of the heap, unless the block is now large enough to map */
+        if (size < mmap_threshold && grow_in_place(ar, ptr, asize)) {
+            UNLOCK(ar);
+            return ptr;
+        }
     }
     
-    /* Copy the old data. */
-    oldsize = GET_SIZE(HDRP(ptr));
-    if (size < oldsize) oldsize = size; {
-        memcpy(newptr, ptr, oldsize);
+    newptr = size >= mmap_threshold ? mmap_malloc(size, DSIZE) : heap_malloc(ar, ALLOC_SIZE(size));
+    
+    /* If realloc() fails the original block is left untouched  */
+    if (newptr) {
+        ar->stats.realloc_copy++;
+        
+        /* Copy the old data and free the old block. */
+        memcpy(newptr, ptr, payload_size(ptr));
+        heap_free(ar, ptr);
     }
-    /* Free the old block. */
-    mm_free(ptr);
+    UNLOCK(ar);
     
+    /* A secondary arena's region is full; place the copy in the main arena, as malloc_block does */
+    if (newptr == NULL && size < mmap_threshold && ar != &arenas[0]) {
+        LOCK(&arenas[0]);
+        newptr = heap_malloc(&arenas[0], ALLOC_SIZE(size));
+        UNLOCK(&arenas[0]);
+        if (newptr) {
+            memcpy(newptr, ptr, payload_size(ptr));
+            LOCK(ar);
+            ar->stats.realloc_copy++;
+            heap_free(ar, ptr);
+            UNLOCK(ar);
+        }
+    }
     return newptr;
 }
 
 /*
- * checkheap - We don't check anything right now.
+ * mm_calloc - Allocate a zeroed array of nmemb elements of size bytes each. Returns NULL if the total size overflows
  */
-void mm_checkheap(int verbose) {
+void *mm_calloc(size_t nmemb, size_t size) {
+    void *bp;
+
+    if (size != 0 && nmemb > (size_t)-1 / size) {
+        return NULL;
+    }
+    bp = calloc_block(nmemb * size);
+    TRACE(MM_TRACE_CALLOC, bp, nmemb * size, NULL);
+    return bp;
 }
 
 /*
- * printblocklist - it will print the blocklist with format as requirements
+ * calloc_block - Allocate a zeroed block with at least size bytes of payload. Large blocks come from a new mapping,
+ *                which is already zero. Other blocks skip the thread cache so that the arena can say whether the
+ *                block is fresh; only a block that may hold old data is cleared in full.
  */
-void mm_printblocklist(void) {
-    char *bp = heap_listp;
-    int count = 0;
-    int num = 0;
-    printf("Size\tAllocated\tStart\t\tEnd\n");
-    for (bp = heap_listp; GET_SIZE(HDRP(bp)) > 0; bp = NEXT_BLKP(bp)) {
-        size_t hsize;
-        hsize = GET_SIZE(HDRP(bp));
-        if (hsize != 0) {
-            num++;
-        }
+static void *calloc_block(size_t size) {
+    size_t asize;
+    arena_t *ar;
+    char *bp;
+    int fresh;
+
+    if (size == 0) {
+        return NULL;
     }
-    for (bp = heap_listp; GET_SIZE(HDRP(bp)) > 0; bp = NEXT_BLKP(bp)) {
-        size_t halloc;
-        halloc = GET_ALLOC(HDRP(bp));
-        count++;
-        if (count == 1 || count == num) {
-            // do nothing
-        }
-        else {
-            /* Add 4 to footer, because FTRP just returns the start of the footer.
-             * Add 4 to factor in the entire length of the footer */
-            printf("%d\t%s\t\t%p\t%p\n", (int)((FTRP(bp) + 4)-HDRP(bp)), (halloc ? "yes" : "no"), HDRP(bp), (FTRP(bp) + 4));
+    if (size >= mmap_threshold) {
+        if ((bp = mmap_malloc(size, DSIZE)) != NULL) {
+            __sync_fetch_and_add(&arenas[0].stats.calloc_fresh, 1);
         }
+        return bp;
+    }
+    if (size > MAX_BLOCK - DSIZE) {
+        return NULL;
     }
+    asize = ALLOC_SIZE(size);
     
-}
-
-/*
- * blocknumbertoblock - this function is to convert block number to corresponding block
- */
-char* mm_blocknumbertoblock(int blocknumber) {
-    char* bp = heap_listp;
-    int count = 0;
-    if (blocknumber <= numberOfBlocks) {
-        for (bp = heap_listp; GET_SIZE(HDRP(bp)) > 0; bp = NEXT_BLKP(bp)) {
-            count++;
-            if (count == blocknumber+1) {
-                //size_t halloc;
-                //halloc = GET_ALLOC(HDRP(bp));
-                // printf("%d\t%s\t\t%p\t%p\n", (int)(FTRP(bp)-HDRP(bp)+1), (halloc ? "yes" : "no"), HDRP(bp), FTRP(bp));
-                break;
-            }
-        }
+    ar = arena_get();
+    if ((bp = heap_malloc(ar, asize)) == NULL && ar != &arenas[0]) {
+        UNLOCK(ar);
+        ar = &arenas[0];
+        LOCK(ar);
+        bp = heap_malloc(ar, asize);
     }
-    else {
-        printf("\"%d\": Invalid block number\n", blocknumber);
+    fresh = bp != NULL && ar->fresh;
+    if (fresh) {
+        ar->stats.calloc_fresh++;
+    }
+    UNLOCK(ar);
+    if (bp == NULL) {
+        return NULL;
+    }
+    
+    if (!fresh) {
+        zero_block(bp, size);
+    }
+    else if (!IN_SLAB(bp)) {
+        /* A fresh heap block was only ever written as a free block: its links and its footer */
+        memset(bp, 0, 2*PSIZE);
+        PUT(bp + GET_SIZE(HDRP(bp)) - DSIZE, 0);
     }
     return bp;
 }
 
 /*
- * getpayloadsize - return the number of bytes with the payload size and padding size
+ * zero_block - Clear the first size bytes of block bp. The whole pages of a large block are released instead, so
+ *              the OS maps zero pages on the next touch and untouched pages cost nothing
  */
-unsigned long mm_getpayloadsize(int blocknumber) {
-    unsigned long totalpayloadsize = 0;
-    char *bp = heap_listp;
-    int i = 0;
-    
-    while(GET_SIZE(HDRP(bp)) > 0) {
-        if(i == blocknumber) {
-            /* Get total size of the block */
-            totalpayloadsize = FTRP(bp) - HDRP(bp) + 1;             // +1 because addresses are zero-based
-            
-            /* Subract the size of the header and footer from the total size of the block */
-            totalpayloadsize -= 2*WSIZE;
-            break;
-        }
-        
-        /* Iterate to next block */
-        bp = NEXT_BLKP(bp);
-        i++;
+static void zero_block(char *bp, size_t size) {
+    size_t pagesize = mem_pagesize();
+    char *lo, *hi;
+
+    if (size < ZERO_RELEASE) {
+        memset(bp, 0, size);
+        return;
     }
-    return totalpayloadsize;
+    lo = (char *)(((uintptr_t)bp + pagesize - 1) & ~(pagesize - 1));
+    hi = (char *)((uintptr_t)(bp + size) & ~(pagesize - 1));
+    mem_release(lo, hi);
+    memset(bp, 0, lo - bp);
+    memset(hi, 0, bp + size - hi);
 }
 
 /*
- * writeheap - Writes a character to the payload space of an allocated block n times
+ * mm_memalign - Allocate a block with at least size bytes of payload at an address that is a multiple of alignment,
+ *               which must be a power of two. mm_free and mm_realloc accept the block like any other
  */
-void mm_writeheap(int blocknumber, char character, int numberOfRepetitions) {
-    char* bp = heap_listp;
-    int i = 0;
-    
-    /* Navigate to block */
-    while (GET_SIZE(HDRP(bp)) > 0) {
-        if (blocknumber == i) {
-            bp = HDRP(bp) + WSIZE;          // Add header size to the header to get to the payload
-            break;
-        }
-        
-        /* Iterate to next block */
-        bp = NEXT_BLKP(bp);
-        i++;
-    }
-    
-    /* Write to payload */
-    int j;
-    for(j = 0; j < numberOfRepetitions; j++) {
-        *(bp + j) = character;
+void *mm_memalign(size_t alignment, size_t size) {
+    void *bp = NULL;
+
+    if (alignment != 0 && (alignment & (alignment - 1)) == 0) {
+        bp = memalign_block(alignment, size);
     }
-    *(bp + j + 1) = '\0';                    // If need to null-terminate characters uncomment this line
+    TRACE(MM_TRACE_MALLOC, bp, size, NULL);
+    return bp;
 }
 
 /*
- * printheap - Prints out the fist numberOfBytesToRead bytes from blocknumber block
+ * mm_aligned_alloc - C11 aligned_alloc: mm_memalign under another name
  */
-void mm_printheap(int blocknumber, int numberOfBytesToRead) {
-    char* bp = heap_listp;
-    int i = 0;
+void *mm_aligned_alloc(size_t alignment, size_t size) {
+    return mm_memalign(alignment, size);
+}
+
+/*
+ * mm_posix_memalign - POSIX posix_memalign: store an aligned block in *memptr. Returns 0 on success, EINVAL if
+ *                     alignment is 0 or not a power of two multiple of sizeof(void *), or ENOMEM
+ */
+int mm_posix_memalign(void **memptr, size_t alignment, size_t size) {
+    void *bp;
+
+    if (alignment == 0 || alignment % sizeof(void *) != 0 || (alignment & (alignment - 1)) != 0) {
+        return EINVAL;
+    }
+    if ((bp = mm_memalign(alignment, size)) == NULL && size != 0) {
+        return ENOMEM;
+    }
+    *memptr = bp;
+    return 0;
+}
+
+/*
+ * mm_usable_size - Return the number of payload bytes of the block at ptr that may be used, at least the size it
+ *                  was requested with. Returns 0 for NULL
+ */
+size_t mm_usable_size(void *ptr) {
+    if (ptr == NULL) {
+        return 0;
+    }
+    return payload_size(ptr);
+}
+
+/*
+ * memalign_block - Allocate a block with at least size bytes of payload aligned to align. Every block is already
+ *                  aligned to DSIZE and every slab slot to SLAB_ALIGN; larger alignments are cut out of a heap block
+ *                  or placed inside a mapping.
+ */
+static void *memalign_block(size_t align, size_t size) {
+    arena_t *ar;
+    char *bp;
+
+    if (size == 0) {
+        return NULL;
+    }
+    if (align <= DSIZE) {
+        return malloc_block(size);
+    }
     
-    /* Navigate to block */
-    while (GET_SIZE(HDRP(bp)) > 0) {
-        if (blocknumber == i) {
-            bp = HDRP(bp) + WSIZE;          // Add header size to the header to get to the payload
-            break;
+    /* Slab slots are aligned to SLAB_ALIGN, but a small request falls back to the heap once the slab zone is used up */
+    if (align <= SLAB_ALIGN && size <= SLAB_MAX && (bp = malloc_block(size)) != NULL) {
+        if (((uintptr_t)bp & (align - 1)) == 0) {
+            return bp;
+        }
+        free_block(bp);
+    }
+    if (size >= mmap_threshold) {
+        return mmap_malloc(size, align);
+    }
+    
+    /* The block must fit in a header with room to slide it up to an aligned address */
+    if (size > MAX_BLOCK - 2*DSIZE - MINBLOCK || align > MAX_BLOCK - 2*DSIZE - MINBLOCK - size) {
+        return NULL;
+    }
+    ar = arena_get();
+    bp = heap_memalign(ar, align, ASIZE(size));
+    UNLOCK(ar);
+    if (bp == NULL && ar != &arenas[0]) {
+        ar = &arenas[0];
+        LOCK(ar);
+        bp = heap_memalign(ar, align, ASIZE(size));
+        UNLOCK(ar);
+    }
+    return bp;
+}
+
+/*
+ * mm_malloc_batch - Allocate count blocks of at least size bytes each into out. Returns the number of blocks
+ *                   allocated, which is short of count only if memory runs out
+ */
+size_t mm_malloc_batch(size_t size, size_t count, void **out) {
+    size_t n = malloc_batch(size, count, out);
+    size_t i;
+
+    for (i = 0; i < n; i++) {
+        TRACE(MM_TRACE_MALLOC, out[i], size, NULL);
+    }
+    return n;
+}
+
+/*
+ * malloc_batch - Allocate up to count blocks of size bytes under a single lock of the thread's arena, falling back
+ *                to the main arena for the rest. Returns the number allocated
+ */
+static size_t malloc_batch(size_t size, size_t count, void **out) {
+    size_t asize, n;
+    arena_t *ar;
+
+    if (size == 0) {
+        return 0;
+    }
+    if (size >= mmap_threshold) {
+        for (n = 0; n < count && (out[n] = mmap_malloc(size, DSIZE)) != NULL; n++) {
+            ;
+        }
+        return n;
+    }
+    if (size > MAX_BLOCK - DSIZE) {
+        return 0;
+    }
+    asize = ALLOC_SIZE(size);
+    
+    ar = arena_get();
+    n = heap_malloc_batch(ar, asize, count, out);
+    UNLOCK(ar);
+    if (n < count && ar != &arenas[0]) {
+        ar = &arenas[0];
+        LOCK(ar);
+        n += heap_malloc_batch(ar, asize, count - n, out + n);
+        UNLOCK(ar);
+    }
+    return n;
+}
+
+/*
+ * mm_free_batch - Free count blocks. ptrs is sorted by address in place, so that runs of neighbouring blocks are
+ *                 freed as one block and coalesced once, and each arena is locked once per run of its blocks. NULL
+ *                 entries are ignored
+ */
+void mm_free_batch(void **ptrs, size_t count) {
+    arena_t *ar = NULL;
+    arena_t *owner;
+    size_t i, size;
+    char *bp;
+
+    qsort(ptrs, count, sizeof(*ptrs), addr_cmp);
+    for (i = 0; i < count; i++) {
+        if ((bp = ptrs[i]) == NULL) {
+            continue;
+        }
+        TRACE(MM_TRACE_FREE, bp, 0, NULL);
+        if (IS_MMAPPED(bp)) {
+            mmap_free(bp);
+            continue;
+        }
+        if ((owner = arena_of(bp)) != ar) {
+            if (ar != NULL) {
+                UNLOCK(ar);
+            }
+            ar = owner;
+            LOCK(ar);
         }
         
-        /* Iterate to next block */
-        bp = NEXT_BLKP(bp);
-        i++;
+        /* Fold the blocks that follow bp in the heap into it, then free them all at once */
+        if (!IN_SLAB(bp)) {
+            size = GET_SIZE(HDRP(bp));
+            while (i + 1 < count && (char *)ptrs[i+1] == bp + size && GET_SIZE(HDRP(bp + size)) != 0) {
+                TRACE(MM_TRACE_FREE, ptrs[i+1], 0, NULL);
+                size += GET_SIZE(HDRP(bp + size));
+                i++;
+            }
+            PUT(HDRP(bp), PACK(size, 1) | GET_PREV_ALLOC(HDRP(bp)));
+        }
+        heap_free(ar, bp);
+    }
+    if (ar != NULL) {
+        UNLOCK(ar);
+    }
+}
+
+/*
+ * mm_pool_create - Create a pool of objects of objsize bytes aligned to align, a power of two, or to DSIZE if align
+ *                  is 0. Returns NULL for a bad alignment or if out of memory
+ */
+mm_pool_t *mm_pool_create(size_t objsize, size_t align) {
+    mm_pool_t *p;
+
+    if (align == 0) {
+        align = DSIZE;
+    }
+    if ((align & (align - 1)) != 0 || align > MAX_BLOCK / 4 || objsize > MAX_BLOCK / (4 * POOL_MIN)) {
+        return NULL;
+    }
+    if ((p = malloc_block(sizeof(mm_pool_t))) == NULL) {
+        return NULL;
+    }
+    memset(p, 0, sizeof(*p));
+    p->align = align;
+    p->objsize = (MAX(objsize, PSIZE) + align - 1) & ~(align - 1);
+#if MM_THREADSAFE
+    Sem_init(&p->mutex, 0, 1);
+#endif
+    
+    POOLS_LOCK();
+    p->next = pools;
+    if (pools != NULL) {
+        pools->prev = p;
+    }
+    pools = p;
+    POOLS_UNLOCK();
+    return p;
+}
+
+/*
+ * mm_pool_alloc - Allocate an object from pool p: the most recently freed one, else the next one in the newest
+ *                 slab, else the first one in a new slab. Returns NULL if out of memory
+ */
+void *mm_pool_alloc(mm_pool_t *p) {
+    char *obj = NULL;
+
+    LOCK(p);
+    if ((obj = p->free) != NULL) {
+        p->free = PRED(obj);
+        p->nfree--;
+    }
+    else if (p->bump < p->end || pool_grow(p, 1) == 0) {
+        obj = p->bump;
+        p->bump += p->objsize;
+    }
+    if (obj != NULL) {
+        p->allocs++;
+    }
+    UNLOCK(p);
+    return obj;
+}
+
+/*
+ * mm_pool_free - Return object obj to pool p, which it must have come from
+ */
+void mm_pool_free(mm_pool_t *p, void *obj) {
+    if (obj == NULL) {
+        return;
+    }
+    LOCK(p);
+    PRED(obj) = p->free;
+    p->free = obj;
+    p->nfree++;
+    p->frees++;
+    UNLOCK(p);
+}
+
+/*
+ * mm_pool_prewarm - Make sure pool p can hand out count objects without taking another slab. Returns 0 on success,
+ *                   -1 if out of memory
+ */
+int mm_pool_prewarm(mm_pool_t *p, size_t count) {
+    size_t avail;
+    int ret = 0;
+
+    LOCK(p);
+    avail = p->nfree + (p->end - p->bump) / p->objsize;
+    if (avail < count) {
+        ret = pool_grow(p, count - p->nfree);
+    }
+    UNLOCK(p);
+    return ret;
+}
+
+/*
+ * mm_pool_destroy - Free pool p and every object in it. Its counters are kept in the main arena's stats
+ */
+void mm_pool_destroy(mm_pool_t *p) {
+    arena_t *ar = &arenas[0];
+    char *slab;
+
+    if (p == NULL) {
+        return;
+    }
+    POOLS_LOCK();
+    if (p->prev != NULL) {
+        p->prev->next = p->next;
+    }
+    else {
+        pools = p->next;
+    }
+    if (p->next != NULL) {
+        p->next->prev = p->prev;
+    }
+    POOLS_UNLOCK();
+    
+    LOCK(ar);
+    while ((slab = p->slabs) != NULL) {
+        p->slabs = PRED(slab);
+        heap_free(ar, slab);
+    }
+    ar->stats.pool_alloc += p->allocs;
+    ar->stats.pool_free += p->frees;
+    ar->stats.pool_slabs += p->nslabs;
+    UNLOCK(ar);
+    free_block(p);
+}
+
+/*
+ * mm_checkheap - Check every arena's heap, free index and slabs for consistency
+ */
+void mm_checkheap(int verbose) {
+    arena_t *ar;
+    int i;
+
+    for (i = 0; i < NARENAS; i++) {
+        ar = &arenas[i];
+        LOCK(ar);
+        if (ar->heap_listp != 0) {
+            checkheap(ar, verbose);
+        }
+        checkslabs(ar);
+        UNLOCK(ar);
+    }
+}
+
+/*
+ * mm_set_policy - Switch the placement policy at runtime. The free index for the new policy is rebuilt from the
+ *                 heap, so the switch costs one walk of the heap. Every arena is locked for the whole switch, since
+ *                 an arena must never run under a policy its free index was not built for. Returns 0 on success, -1
+ *                 for an unknown policy.
+ */
+int mm_set_policy(int policy) {
+    int i;
+
+    if (policy != MM_FIRSTFIT && policy != MM_NEXTFIT && policy != MM_BESTFIT && policy != MM_SEGFIT) {
+        return -1;
+    }
+    for (i = 0; i < NARENAS; i++) {
+        LOCK(&arenas[i]);
+    }
+    fit_policy = policy;
+    for (i = 0; i < NARENAS; i++) {
+        if (arenas[i].heap_listp != 0) {
+            rebuild_free_index(&arenas[i]);
+        }
+    }
+    for (i = NARENAS - 1; i >= 0; i--) {
+        UNLOCK(&arenas[i]);
+    }
+    return 0;
+}
+
+/*
+ * mm_get_policy - Return the current placement policy
+ */
+int mm_get_policy(void) {
+    return fit_policy;
+}
+
+/*
+ * mm_setopt - Set allocator option opt to value. Returns 0 on success, -1 for an unknown option.
+ */
+int mm_setopt(int opt, size_t value) {
+    arena_t *ar;
+    int i;
+
+    switch (opt) {
+    case MM_OPT_MMAP_THRESHOLD:
+        mmap_threshold = value ? value : (size_t)-1;
+        return 0;
+    case MM_OPT_TRIM_THRESHOLD:
+        trim_threshold = value ? value : (size_t)-1;
+        return 0;
+    case MM_OPT_RELEASE_THRESHOLD:
+        release_threshold = value ? value : (size_t)-1;
+        return 0;
+    case MM_OPT_QUICK_MAX:
+        /* Coalesce whatever is waiting, so no quick list holds blocks above the new limit */
+        for (i = 0; i < NARENAS; i++) {
+            ar = &arenas[i];
+            LOCK(ar);
+            quick_max = MIN(value, MM_QUICK_MAX);
+            if (ar->heap_listp != 0) {
+                consolidate(ar);
+            }
+            UNLOCK(ar);
+        }
+        return 0;
+    default:
+        return -1;
+    }
+}
+
+/*
+ * mm_trim - Give unused memory back to the OS: shrink every heap until less than pad bytes plus a page are free at
+ *           its top, and release the pages inside all free blocks. Returns 1 if a heap shrank, else 0.
+ */
+int mm_trim(size_t pad) {
+    size_t trimmed = 0;
+    arena_t *ar;
+    int i;
+
+    for (i = 0; i < NARENAS; i++) {
+        ar = &arenas[i];
+        LOCK(ar);
+        if (ar->heap_listp != 0) {
+            consolidate(ar);
+            trimmed += trim_top(ar, pad);
+            release_free(ar);
+        }
+        UNLOCK(ar);
+    }
+    return trimmed > 0;
+}
+
+/*
+ * mm_getstats - Copy the allocator's counters, summed over all arenas, into *st
+ */
+void mm_getstats(mm_stats_t *st) {
+    unsigned long *sum = (unsigned long *)st;   /* Every field of mm_stats_t is an unsigned long counter */
+    unsigned long *cnt;
+    arena_t *ar;
+    mm_pool_t *p;
+    size_t k;
+    int i;
+
+    memset(st, 0, sizeof(*st));
+    for (i = 0; i < NARENAS; i++) {
+        ar = &arenas[i];
+        LOCK(ar);
+        cnt = (unsigned long *)&ar->stats;
+        for (k = 0; k < sizeof(mm_stats_t) / sizeof(unsigned long); k++) {
+            sum[k] += cnt[k];
+        }
+        UNLOCK(ar);
+    }
+    
+    /* Live pools keep their own counters */
+    POOLS_LOCK();
+    for (p = pools; p != NULL; p = p->next) {
+        LOCK(p);
+        st->pool_alloc += p->allocs;
+        st->pool_free += p->frees;
+        st->pool_slabs += p->nslabs;
+        UNLOCK(p);
+    }
+    POOLS_UNLOCK();
+}
+
+/*
+ * mm_footprint - Return the number of bytes the allocator holds from the OS: every heap up to its break, the slabs
+ *                handed out and the mapped blocks
+ */
+size_t mm_footprint(void) {
+    size_t total = mem_heapsize() + slab_bytes + mmap_bytes;
+    arena_t *ar;
+    int i;
+
+    for (i = 1; i < NARENAS; i++) {
+        ar = &arenas[i];
+        LOCK(ar);
+        total += ar->brk - ar->lo;
+        UNLOCK(ar);
+    }
+    return total;
+}
+
+/*
+ * mm_printstats - Print the allocator's counters
+ */
+void mm_printstats(void) {
+    mm_stats_t stats;
+
+    mm_getstats(&stats);
+    printf("realloc shrunk in place:\t%lu\n", stats.realloc_shrink);
+    printf("realloc grown in place:\t\t%lu\n", stats.realloc_grow);
+    printf("realloc grown at heap end:\t%lu\n", stats.realloc_extend);
+    printf("realloc copied:\t\t\t%lu\n", stats.realloc_copy);
+#if MM_THREADSAFE
+    printf("thread cache refills:\t\t%lu\n", stats.tcache_refill);
+    printf("thread cache flushes:\t\t%lu\n", stats.tcache_flush);
+#endif
+    printf("large blocks mapped:\t\t%lu\n", stats.mmap_alloc);
+    printf("large blocks unmapped:\t\t%lu\n", stats.mmap_free);
+    printf("bytes trimmed from heap top:\t%lu\n", stats.trim_bytes);
+    printf("free page release sweeps:\t%lu\n", stats.release_sweeps);
+    printf("calloc blocks left unzeroed:\t%lu\n", stats.calloc_fresh);
+    printf("quick list hits:\t\t%lu\n", stats.quick_hits);
+    printf("quick list sweeps:\t\t%lu\n", stats.quick_sweeps);
+    printf("pool objects allocated:\t\t%lu\n", stats.pool_alloc);
+    printf("pool objects freed:\t\t%lu\n", stats.pool_free);
+    printf("pool slabs:\t\t\t%lu\n", stats.pool_slabs);
+}
+
+/*
+ * printblocklist - it will print the blocklist with format as requirements
+ */
+void mm_printblocklist(void) {
+    arena_t *ar = &arenas[0];          /* The shell works on the main arena */
+    char *bp = ar->heap_listp;
+    char *sp;
+    slab_t *s;
+    unsigned int i;
+    int count = 0;
+    int num = 0;
+    printf("Size\tAllocated\tStart\t\tEnd\n");
+    for (bp = ar->heap_listp; GET_SIZE(HDRP(bp)) > 0; bp = NEXT_BLKP(bp)) {
+        size_t hsize;
+        hsize = GET_SIZE(HDRP(bp));
+        if (hsize != 0) {
+            num++;
+        }
+    }
+    for (bp = ar->heap_listp; GET_SIZE(HDRP(bp)) > 0; bp = NEXT_BLKP(bp)) {
+        size_t halloc;
+        halloc = GET_ALLOC(HDRP(bp));
+        count++;
+        if (count == 1 || count == num) {
+            // do nothing
+        }
+        else {
+            /* Allocated blocks have no footer, so the block ends GET_SIZE bytes past the start of its header */
+            printf("%d\t%s\t\t%p\t%p\n", (int)GET_SIZE(HDRP(bp)), (halloc ? "yes" : "no"), HDRP(bp), HDRP(bp) + GET_SIZE(HDRP(bp)));
+        }
+    }
+    
+    /* Slab objects live outside the heap; list the allocated slots of every slab */
+    for (sp = slab_zone; sp != NULL && sp < slab_zone + MIN(slab_top, SLAB_ZONE); sp += SLAB_SIZE) {
+        s = (slab_t *)sp;
+        for (i = 0; i < s->nslots; i++) {
+            if (!((s->map[i / 64] >> (i % 64)) & 1)) {
+                bp = sp + SLAB_HDR + i * s->size;
+                printf("%d\tyes\t\t%p\t%p\n", s->size, bp, bp + s->size);
+            }
+        }
+    }
+}
+
+/*
+ * blocknumbertoblock - this function is to convert block number to corresponding block
+ */
+char* mm_blocknumbertoblock(int blocknumber) {
+    char *bp = mm_hget(blocknumber);
+
+    if (bp == NULL) {
+        printf("\"%d\": Invalid block number\n", blocknumber);
+    }
+    return bp;
+}
+
+/*
+ * getpayloadsize - return the number of bytes with the payload size and padding size
+ */
+unsigned long mm_getpayloadsize(int blocknumber) {
+    char *bp = mm_hget(blocknumber);
+
+    if (bp == NULL) {
+        return 0;
+    }
+    return payload_size(bp);
+}
+
+/*
+ * writeheap - Writes a character to the payload space of an allocated block n times
+ */
+void mm_writeheap(int blocknumber, char character, int numberOfRepetitions) {
+    char* bp = mm_hget(blocknumber);
+    
+    if (bp == NULL) {
+        return;
+    }
+    
+    /* Write to payload */
+    int j;
+    for(j = 0; j < numberOfRepetitions; j++) {
+        *(bp + j) = character;
+    }
+    *(bp + j + 1) = '\0';                    // If need to null-terminate characters uncomment this line
+}
+
+/*
+ * printheap - Prints out the fist numberOfBytesToRead bytes from blocknumber block
+ */
+void mm_printheap(int blocknumber, int numberOfBytesToRead) {
+    char* bp = mm_hget(blocknumber);
+    
+    if (bp == NULL) {
+        return;
     }
     
     int k = 0;
@@ -393,59 +1564,577 @@ void mm_printheap(int blocknumber, int numberOfBytesToRead) {
             return;
         }
     }
-    
-    /* Print out first numberOfBytesToRead from block */
-    int j;
-    for(j = 0; j < numberOfBytesToRead; j++) {
-        printf("%c", *(bp + j));
+    
+    /* Print out first numberOfBytesToRead from block */
+    int j;
+    for(j = 0; j < numberOfBytesToRead; j++) {
+        printf("%c", *(bp + j));
+    }
+    printf("\n");
+}
+
+/*
+ * freebufferinblock - delete character that write inside the block
+ */
+void mm_freebufferinblock(char* bp) {
+    int j;
+    unsigned long totalpayloadsize = payload_size(bp);
+    int numberOfCharacterInBlock = (int)totalpayloadsize / 2;
+    for(j = 0; j < numberOfCharacterInBlock; j++) {
+        *(bp + j) = '\0';
+    }
+}
+
+/*
+ * mm_halloc - Allocate a block with at least size bytes of payload and return a handle for it, or -1
+ */
+int mm_halloc(size_t size) {
+    void *bp;
+    int h;
+
+    if ((bp = mm_malloc(size)) == NULL) {
+        return -1;
+    }
+    HANDLE_LOCK();
+    if (handle_free != 0) {
+        h = handle_free;
+        handle_free = handles[h] >> 1;
+    }
+    else if (handle_top < handle_cap || grow_handles() == 0) {
+        h = handle_top++;
+    }
+    else {
+        HANDLE_UNLOCK();
+        mm_free(bp);
+        return -1;
+    }
+    handles[h] = (uintptr_t)bp;
+    HANDLE_UNLOCK();
+    return h;
+}
+
+/*
+ * mm_hget - Return the block with handle h, or NULL if h names no allocated block
+ */
+void *mm_hget(int h) {
+    void *bp = NULL;
+
+    HANDLE_LOCK();
+    if (h > 0 && h < handle_top && !(handles[h] & 1)) {
+        bp = (void *)handles[h];
+    }
+    HANDLE_UNLOCK();
+    return bp;
+}
+
+/*
+ * mm_hfree - Free the block with handle h and recycle the handle. Does nothing if h names no allocated block
+ */
+void mm_hfree(int h) {
+    void *bp;
+
+    HANDLE_LOCK();
+    if (h <= 0 || h >= handle_top || (handles[h] & 1)) {
+        HANDLE_UNLOCK();
+        return;
+    }
+    bp = (void *)handles[h];
+    handles[h] = ((uintptr_t)handle_free << 1) | 1;
+    handle_free = h;
+    HANDLE_UNLOCK();
+    mm_free(bp);
+}
+
+/*
+ * The remaining routines are internal helper routines
+ */
+
+/*
+ * arena_get - Return the calling thread's arena, locked. A thread is bound round robin on its first allocation; if
+ *             its arena is busy it moves to the first idle one, so contended threads spread out by load.
+ */
+static arena_t *arena_get(void) {
+#if MM_THREADSAFE
+    arena_t *ar = thread_arena;
+    arena_t *other;
+    int i;
+
+    Pthread_once(&heap_once, heap_once_init);
+    if (ar == NULL) {
+        ar = thread_arena = &arenas[__sync_fetch_and_add(&next_arena, 1) % NARENAS];
+    }
+    if (sem_trywait(&ar->mutex) == 0) {
+        return ar;
+    }
+    for (i = 1; i < NARENAS; i++) {
+        other = &arenas[(ar - arenas + i) % NARENAS];
+        if (sem_trywait(&other->mutex) == 0) {
+            thread_arena = other;
+            return other;
+        }
+    }
+    P(&ar->mutex);
+    return ar;
+#else
+    return &arenas[0];
+#endif
+}
+
+/*
+ * arena_of - Return the arena that owns block bp: the owner of its slab, or the arena whose heap holds it. Neither
+ *            changes while bp is allocated, so this needs no lock. A region's bounds are set once; arena_sbrk
+ *            publishes lo after max, so a region seen here comes with its end
+ */
+static arena_t *arena_of(void *bp) {
+    char *lo;
+    int i;
+
+    if (IN_SLAB(bp)) {
+        return SLAB_OF(bp)->ar;
+    }
+    for (i = 1; i < NARENAS; i++) {
+        lo = __atomic_load_n(&arenas[i].lo, __ATOMIC_ACQUIRE);
+        if (lo != NULL && (char *)bp >= lo && (char *)bp < arenas[i].max) {
+            return &arenas[i];
+        }
+    }
+    return &arenas[0];
+}
+
+/*
+ * arena_sbrk - Extend arena ar's heap by incr bytes and return the start of the new area, or (void *)-1. The main
+ *              arena uses mem_sbrk; a secondary arena bumps its break within a region it reserves on first use. A
+ *              negative incr shrinks the heap and releases the pages above the new break.
+ */
+static void *arena_sbrk(arena_t *ar, intptr_t incr) {
+    char *old_brk;
+
+    if (ar == &arenas[0]) {
+        return mem_sbrk(incr);
+    }
+    if (ar->lo == NULL) {
+        old_brk = mmap(NULL, MAX_HEAP, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (old_brk == MAP_FAILED) {
+            return (void *)-1;
+        }
+        ar->brk = ar->touched = old_brk;
+        ar->max = old_brk + MAX_HEAP;
+        __atomic_store_n(&ar->lo, old_brk, __ATOMIC_RELEASE);   /* Read unlocked by arena_of */
+    }
+    if (incr > ar->max - ar->brk || incr < ar->lo - ar->brk) {
+        return (void *)-1;
+    }
+    old_brk = ar->brk;
+    ar->brk += incr;
+    if (incr < 0) {
+        mem_release(ar->brk, old_brk);
+    }
+    ar->touched = MAX(ar->touched, ar->brk);
+    return old_brk;
+}
+
+/*
+ * arena_touched - Return the highest break arena ar's heap has had. Memory above it has never been written, not even
+ *                 by an earlier heap in the same region
+ */
+static char *arena_touched(arena_t *ar) {
+    if (ar == &arenas[0]) {
+        return mem_touched();
+    }
+    return ar->touched;
+}
+
+/*
+ * trim_top - If the last block of arena ar's heap is free, shrink the heap to leave at least pad bytes of it, in
+ *            whole pages. Returns the number of bytes trimmed. Called with the arena lock held
+ */
+static size_t trim_top(arena_t *ar, size_t pad) {
+    char *brk = arena_sbrk(ar, 0);
+    size_t size, keep, release;
+    char *bp;
+
+    /* The epilogue's prev-allocated bit says whether the last block is free */
+    if (GET_PREV_ALLOC(brk - WSIZE)) {
+        return 0;
+    }
+    size = GET_SIZE(brk - DSIZE);
+    bp = brk - size;
+    keep = MAX(MINBLOCK, pad);
+    if (size < keep + CHUNKSIZE) {
+        return 0;
+    }
+    release = (size - keep) / CHUNKSIZE * CHUNKSIZE;
+    
+    remove_free(ar, bp);
+    size -= release;
+    PUT(HDRP(bp), PACK(size, 0) | GET_PREV_ALLOC(HDRP(bp)));
+    PUT(FTRP(bp), PACK(size, 0));
+    PUT(HDRP(NEXT_BLKP(bp)), PACK(0, 1));   /* New epilogue header */
+    arena_sbrk(ar, -(intptr_t)release);
+    insert_free(ar, bp);
+    ar->free_low = MIN(ar->free_low, ar->free_bytes);
+    
+    ar->stats.trim_bytes += release;
+    return release;
+}
+
+/*
+ * release_free - Give the whole pages inside every free block of arena ar back to the OS and zero the partial pages
+ *                at either end, so the block is marked clean and later sweeps skip it until it merges with a
+ *                written block. The header, free links and footer stay in place. Called with the arena lock held
+ */
+static void release_free(arena_t *ar) {
+    size_t pagesize = mem_pagesize();
+    char *bp, *lo, *hi;
+
+    for (bp = ar->heap_listp; GET_SIZE(HDRP(bp)) > 0; bp = NEXT_BLKP(bp)) {
+        if (GET_ALLOC(HDRP(bp)) || (GET(HDRP(bp)) & CLEAN)) {
+            continue;   /* In use, or zero since it was last released */
+        }
+        lo = (char *)(((uintptr_t)bp + 2*PSIZE + pagesize - 1) & ~(uintptr_t)(pagesize - 1));
+        hi = (char *)((uintptr_t)FTRP(bp) & ~(uintptr_t)(pagesize - 1));
+        if (lo >= hi) {
+            continue;   /* No whole page inside */
+        }
+        mem_release(lo, hi);
+        memset(bp + 2*PSIZE, 0, lo - (bp + 2*PSIZE));
+        memset(hi, 0, FTRP(bp) - hi);
+        PUT(HDRP(bp), GET(HDRP(bp)) | CLEAN);
+    }
+    ar->free_low = ar->free_bytes;
+    ar->stats.release_sweeps++;
+}
+
+/*
+ * slab_malloc - Allocate a slot of size bytes from one of arena ar's slabs, starting a new slab if none has a free
+ *               slot. size must be a multiple of SLAB_ALIGN. Called with the arena lock held
+ */
+static void *slab_malloc(arena_t *ar, size_t size) {
+    slab_t *s = ar->slabs[size / SLAB_ALIGN - 1];
+    unsigned int i, slot;
+
+    if (s == NULL && (s = slab_new(ar, size)) == NULL) {
+        return NULL;
+    }
+    
+    /* Take the lowest free slot */
+    for (i = 0; s->map[i] == 0; i++) {
+        ;
+    }
+    slot = 64 * i + __builtin_ctzll(s->map[i]);
+    s->map[i] &= s->map[i] - 1;
+    ar->fresh = slot >= s->used;
+    if (ar->fresh) {
+        s->used = slot + 1;
+    }
+    
+    /* A full slab leaves the list until one of its objects is freed */
+    if (--s->nfree == 0) {
+        ar->slabs[size / SLAB_ALIGN - 1] = s->next;
+        if (s->next != NULL) {
+            s->next->prev = NULL;
+        }
+    }
+    return (char *)s + SLAB_HDR + slot * s->size;
+}
+
+/*
+ * slab_free - Return slab object bp to its slab. A slab that becomes empty moves to the arena's empty list unless it
+ *             is the only slab left for its size. Called with the lock of the owning arena held
+ */
+static void slab_free(arena_t *ar, void *bp) {
+    slab_t *s = SLAB_OF(bp);
+    slab_t **list = &ar->slabs[s->size / SLAB_ALIGN - 1];
+    unsigned int slot = ((char *)bp - (char *)s - SLAB_HDR) / s->size;
+
+    s->map[slot / 64] |= 1ULL << (slot % 64);
+    
+    /* A full slab rejoins the list on its first free */
+    if (s->nfree++ == 0) {
+        s->prev = NULL;
+        s->next = *list;
+        if (*list != NULL) {
+            (*list)->prev = s;
+        }
+        *list = s;
+    }
+    
+    if (s->nfree == s->nslots && (s->prev != NULL || s->next != NULL)) {
+        if (s->prev != NULL) {
+            s->prev->next = s->next;
+        }
+        else {
+            *list = s->next;
+        }
+        if (s->next != NULL) {
+            s->next->prev = s->prev;
+        }
+        s->next = ar->slab_empty;
+        ar->slab_empty = s;
+    }
+}
+
+/*
+ * slab_new - Set up a slab of size byte slots for arena ar and put it on the arena's list, reusing an empty slab
+ *            if there is one. The slab zone is reserved on first use, as an inaccessible range like the main heap;
+ *            each arena commits SLAB_CHUNK bytes of it at a time and cuts its slabs from them. Returns NULL when the
+ *            zone is exhausted
+ */
+static slab_t *slab_new(arena_t *ar, size_t size) {
+    char *zone = slab_zone;
+    slab_t *s;
+    size_t top;
+    unsigned int i;
+
+    if ((s = ar->slab_empty) != NULL) {
+        ar->slab_empty = s->next;
+    }
+    else {
+        if (ar->slab_next == ar->slab_end) {
+            if (zone == NULL) {
+                zone = mmap(NULL, SLAB_ZONE, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+                if (zone == MAP_FAILED) {
+                    return NULL;
+                }
+                /* Another arena may have reserved the zone meanwhile; keep whichever came first */
+                if (!__sync_bool_compare_and_swap(&slab_zone, NULL, zone)) {
+                    munmap(zone, SLAB_ZONE);
+                    zone = slab_zone;
+                }
+            }
+            if ((top = __sync_fetch_and_add(&slab_top, SLAB_CHUNK)) >= SLAB_ZONE) {
+                return NULL;
+            }
+            if (mprotect(zone + top, SLAB_CHUNK, PROT_READ | PROT_WRITE) < 0) {
+                return NULL;
+            }
+            ar->slab_next = zone + top;
+            ar->slab_end = zone + top + SLAB_CHUNK;
+        }
+        s = (slab_t *)ar->slab_next;
+        ar->slab_next += SLAB_SIZE;
+        s->used = 0;
+        __sync_fetch_and_add(&slab_bytes, SLAB_SIZE);
+    }
+    
+    s->ar = ar;
+    s->size = size;
+    s->nslots = (SLAB_SIZE - SLAB_HDR) / size;
+    if (s->used != 0) {
+        s->used = s->nslots;   /* A reused slab may have been written anywhere */
+    }
+    s->nfree = s->nslots;
+    for (i = 0; i < SLAB_WORDS; i++) {
+        if (64 * (i + 1) <= s->nslots) {
+            s->map[i] = ~0ULL;
+        }
+        else if (64 * i < s->nslots) {
+            s->map[i] = (1ULL << (s->nslots % 64)) - 1;
+        }
+        else {
+            s->map[i] = 0;
+        }
+    }
+    s->prev = NULL;
+    s->next = ar->slabs[size / SLAB_ALIGN - 1];
+    if (s->next != NULL) {
+        s->next->prev = s;
+    }
+    ar->slabs[size / SLAB_ALIGN - 1] = s;
+    return s;
+}
+
+/*
+ * pool_grow - Give pool p a new slab with room for at least count objects, from the main arena's heap. What was left
+ *             of the previous slab moves to the free list. Returns 0 on success, -1 if out of memory. Called with the
+ *             pool lock held
+ */
+static int pool_grow(mm_pool_t *p, size_t count) {
+    arena_t *ar = &arenas[0];
+    size_t n = MAX(count, MAX(POOL_MIN, POOL_SLAB / p->objsize));
+    char *slab;
+
+    /* The slab holds its link word, then the objects from the first aligned address after it */
+    if (n > (MAX_BLOCK - 2*DSIZE - PSIZE - p->align) / p->objsize) {
+        return -1;
+    }
+    LOCK(ar);
+    slab = heap_malloc(ar, ASIZE(PSIZE + p->align + n * p->objsize));
+    UNLOCK(ar);
+    if (slab == NULL) {
+        return -1;
+    }
+    
+    for (; p->bump < p->end; p->bump += p->objsize) {
+        PRED(p->bump) = p->free;
+        p->free = p->bump;
+        p->nfree++;
+    }
+    PRED(slab) = p->slabs;
+    p->slabs = slab;
+    p->bump = (char *)(((uintptr_t)slab + PSIZE + p->align - 1) & ~(uintptr_t)(p->align - 1));
+    p->end = p->bump + n * p->objsize;
+    p->nslabs++;
+    return 0;
+}
+
+/*
+ * addr_cmp - qsort comparison of two block pointers by address
+ */
+static int addr_cmp(const void *a, const void *b) {
+    uintptr_t x = (uintptr_t)*(void * const *)a;
+    uintptr_t y = (uintptr_t)*(void * const *)b;
+
+    return x < y ? -1 : x > y;
+}
+
+/*
+ * mmap_malloc - Allocate a block of at least size bytes in a mapping of its own, aligned to align, a power of two of
+ *               at least DSIZE. The counters live in the main arena's stats but are updated without its lock.
+ *               Returns NULL if the mapping fails
+ */
+static void *mmap_malloc(size_t size, size_t align) {
+    size_t pagesize = mem_pagesize();
+    size_t len;
+    char *map, *bp;
+
+    /* The mapping length must fit in the header */
+    if (align > MAX_BLOCK - pagesize || size > MAX_BLOCK - pagesize - align) {
+        return NULL;
+    }
+    len = (size + align + pagesize - 1) & ~(pagesize - 1);
+    if ((map = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0)) == MAP_FAILED) {
+        return NULL;
+    }
+    
+    /* The header and offset words fit in front of the first aligned address past them, at most align bytes in */
+    bp = (char *)(((uintptr_t)map + DSIZE + align - 1) & ~(uintptr_t)(align - 1));
+    PUT(bp - DSIZE, bp - map);                     /* Offset from the start of the mapping */
+    PUT(HDRP(bp), PACK(len, 1) | MMAPPED);
+    __sync_fetch_and_add(&mmap_bytes, len);
+    __sync_fetch_and_add(&arenas[0].stats.mmap_alloc, 1);
+    return bp;
+}
+
+/*
+ * mmap_realloc - Resize mapped block bp to hold at least size bytes with mremap, which may move the mapping but
+ *                never copies the data. The block keeps its offset in the mapping, so it stays aligned to DSIZE;
+ *                a larger alignment from mm_memalign is not kept if the mapping moves. Returns the block, or NULL
+ *                with bp untouched if the mapping cannot be resized
+ */
+static void *mmap_realloc(void *bp, size_t size) {
+    size_t pagesize = mem_pagesize();
+    size_t off = GET((char *)bp - DSIZE);
+    size_t oldlen = GET_SIZE(HDRP(bp));
+    size_t len;
+    char *map;
+
+    if (size > MAX_BLOCK - pagesize - off) {
+        return NULL;
+    }
+    len = (off + size + pagesize - 1) & ~(pagesize - 1);
+    if (len != oldlen) {
+        if ((map = mremap(MMAP_BASE(bp), oldlen, len, MREMAP_MAYMOVE)) == MAP_FAILED) {
+            return NULL;
+        }
+        bp = map + off;
+        PUT(HDRP(bp), PACK(len, 1) | MMAPPED);
+        __sync_fetch_and_add(&mmap_bytes, len - oldlen);
+    }
+    if (len > oldlen) {
+        __sync_fetch_and_add(&arenas[0].stats.realloc_grow, 1);
+    }
+    else {
+        __sync_fetch_and_add(&arenas[0].stats.realloc_shrink, 1);
     }
-    printf("\n");
+    return bp;
 }
 
 /*
- * freebufferinblock - delete character that write inside the block
+ * mmap_free - Unmap mapped block bp
  */
-void mm_freebufferinblock(char* bp) {
-    int j;
-    unsigned long totalpayloadsize = FTRP(bp) - HDRP(bp) + 1;
-    totalpayloadsize -= 2*WSIZE;
-    int numberOfCharacterInBlock = (int)totalpayloadsize / 2;
-    for(j = 0; j < numberOfCharacterInBlock; j++) {
-        *(bp + j) = '\0';
-    }
+static void mmap_free(void *bp) {
+    __sync_fetch_and_sub(&mmap_bytes, GET_SIZE(HDRP(bp)));
+    munmap(MMAP_BASE(bp), GET_SIZE(HDRP(bp)));
+    __sync_fetch_and_add(&arenas[0].stats.mmap_free, 1);
 }
 
 /*
- * getBlockArrayElement - Provides an interface to read a blockArray element in outside modules
+ * payload_size - Return the number of payload bytes in allocated block bp
  */
-void *getBlockArrayElement(int blockNumber) {
-	return blockArray[blockNumber];
+static size_t payload_size(void *bp) {
+    if (IN_SLAB(bp)) {
+        return SLAB_OF(bp)->size;
+    }
+    if (IS_MMAPPED(bp)) {
+        return GET_SIZE(HDRP(bp)) - GET((char *)bp - DSIZE);
+    }
+    return GET_SIZE(HDRP(bp)) - WSIZE;   /* Allocated blocks have no footer */
 }
 
 /*
- * The remaining routines are internal helper routines
+ * grow_handles - Double the handle table. The table is mapped directly so it never competes with the heaps it
+ *                describes. Returns 0 on success, -1 if the mapping fails. Called with the handle lock held
  */
+static int grow_handles(void) {
+    int cap = handle_cap ? 2 * handle_cap : 1024;
+    uintptr_t *table;
+
+    table = mmap(NULL, cap * sizeof(*table), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (table == MAP_FAILED) {
+        return -1;
+    }
+    if (handles != NULL) {
+        memcpy(table, handles, handle_cap * sizeof(*table));
+        munmap(handles, handle_cap * sizeof(*table));
+    }
+    handles = table;
+    handle_cap = cap;
+    return 0;
+}
 
 /*
  * extend_heap - Extend heap with free block and return its block pointer
  */
 /* $begin mmextendheap */
-static void *extend_heap(size_t words) {
+static void *extend_heap(arena_t *ar, size_t words) {
     char *bp;
     size_t size;
+    char *touched = arena_touched(ar);
+    char *merged;
+    tag_t clean;
+    int prev_clean;
 
     /* Allocate an even number of words to maintain alignment */
     size = (words % 2) ? (words+1) * WSIZE : words * WSIZE; //line:vm:mm:beginextend
-    if ((long)(bp = mem_sbrk(size)) == -1) {
+    if ((long)(bp = arena_sbrk(ar, size)) == -1) {
 		return NULL;                                        //line:vm:mm:endextend
 	}
+    clean = bp >= touched ? CLEAN : 0;   /* New memory above every earlier break is still zero */
+    ar->free_low += size;                /* Growing the heap is not freeing; keep it out of the sweep trigger */
+    if (ar->trimmed) {
+        /* The heap regrows after a trim; keep more at the top next time */
+        ar->top_pad = MIN(2 * ar->top_pad, TOP_PAD_MAX);
+        ar->trimmed = 0;
+    }
     /* Initialize free block header/footer and the epilogue header */
-    PUT(HDRP(bp), PACK(size, 0));         /* Free block header */   //line:vm:mm:freeblockhdr
+    PUT(HDRP(bp), PACK(size, 0) | GET_PREV_ALLOC(HDRP(bp)) | clean); /* Free block header */ //line:vm:mm:freeblockhdr
     PUT(FTRP(bp), PACK(size, 0));         /* Free block footer */   //line:vm:mm:freeblockftr
     PUT(HDRP(NEXT_BLKP(bp)), PACK(0, 1)); /* New epilogue header */ //line:vm:mm:newepihdr
     
     /* Coalesce if the previous block was free */
-    return coalesce(bp);                                          	//line:vm:mm:returnblock
+    /* $end mmextendheap */
+    prev_clean = !GET_PREV_ALLOC(HDRP(bp)) && (GET(HDRP(PREV_BLKP(bp))) & CLEAN);
+    if (clean && prev_clean) {
+        /* Both halves are clean; clearing the two boundary tags between them keeps the merged block clean */
+        merged = coalesce(ar, bp);
+        PUT(bp - DSIZE, 0);
+        PUT(HDRP(bp), 0);
+        PUT(HDRP(merged), GET(HDRP(merged)) | CLEAN);
+        return merged;
+    }
+    /* $begin mmextendheap */
+    return coalesce(ar, bp);                                          	//line:vm:mm:returnblock
 }
 /* $end mmextendheap */
 
@@ -455,93 +2144,583 @@ static void *extend_heap(size_t words) {
  */
 /* $begin mmplace */
 /* $begin mmplace-proto */
-static void place(void *bp, size_t asize) {
+static void place(arena_t *ar, void *bp, size_t asize) {
     /* $end mmplace-proto */
     size_t csize = GET_SIZE(HDRP(bp));
+    tag_t clean = GET(HDRP(bp)) & CLEAN;
     
-    if ((csize - asize) >= (2*DSIZE)) {
-		PUT(HDRP(bp), PACK(asize, 1));
-		PUT(FTRP(bp), PACK(asize, 1));
+    /* A clean block stays clean when it is split; the remainder's header lies outside both payloads */
+    ar->fresh = clean != 0;
+    remove_free(ar, bp);
+    if ((csize - asize) >= MINBLOCK) {
+		PUT(HDRP(bp), PACK(asize, 1) | PREV_ALLOC);
 		bp = NEXT_BLKP(bp);
-		PUT(HDRP(bp), PACK(csize-asize, 0));
+		PUT(HDRP(bp), PACK(csize-asize, 0) | PREV_ALLOC | clean);
 		PUT(FTRP(bp), PACK(csize-asize, 0));
+		insert_free(ar, bp);
     }
     else {
-		PUT(HDRP(bp), PACK(csize, 1));
-		PUT(FTRP(bp), PACK(csize, 1));
+		PUT(HDRP(bp), PACK(csize, 1) | PREV_ALLOC);
+		SET_PREV_ALLOC(NEXT_BLKP(bp));
     }
+    ar->free_low = MIN(ar->free_low, ar->free_bytes);
 }
 /* $end mmplace */
 
 /*
- * find_fit - Find a fit for a block with asize bytes
+ * shrink_block - Trim allocated block bp down to asize bytes, freeing the tail if it is at least minimum block size
+ */
+static void shrink_block(arena_t *ar, void *bp, size_t asize) {
+    size_t csize = GET_SIZE(HDRP(bp));
+    char *rest;
+    
+    if ((csize - asize) >= MINBLOCK) {
+        PUT(HDRP(bp), PACK(asize, 1) | GET_PREV_ALLOC(HDRP(bp)));
+        rest = NEXT_BLKP(bp);
+        PUT(HDRP(rest), PACK(csize-asize, 0) | PREV_ALLOC);
+        PUT(FTRP(rest), PACK(csize-asize, 0));
+        CLR_PREV_ALLOC(NEXT_BLKP(rest));
+        coalesce(ar, rest);
+    }
+}
+
+/*
+ * grow_in_place - Grow allocated block bp to at least asize bytes by absorbing the free block after it. If bp is
+ *                 the last block (or only a free block sits between it and the epilogue) the heap is extended
+ *                 first. Returns 1 on success, 0 if bp cannot grow where it is.
+ */
+static int grow_in_place(arena_t *ar, void *bp, size_t asize) {
+    size_t csize = GET_SIZE(HDRP(bp));
+    char *next = NEXT_BLKP(bp);
+    int extended = 0;
+    
+    if (!GET_ALLOC(HDRP(next))) {
+        csize += GET_SIZE(HDRP(next));
+        if (csize < asize && GET_SIZE(HDRP(NEXT_BLKP(next))) != 0) {
+            return 0;   /* Free successor too small and not at the end of the heap */
+        }
+    }
+    else if (GET_SIZE(HDRP(next)) != 0) {
+        return 0;       /* Allocated successor */
+    }
+    
+    /* bp ends the heap (ignoring a trailing free block), so more heap lands right after it */
+    if (csize < asize) {
+        if (extend_heap(ar, MAX(asize - csize, CHUNKSIZE)/WSIZE) == NULL) {
+            return 0;
+        }
+        extended = 1;
+    }
+    
+    /* Absorb the free successor, then give back whatever is beyond asize */
+    next = NEXT_BLKP(bp);
+    remove_free(ar, next);
+    if (ar->rover == next) {
+        ar->rover = bp;
+    }
+    csize = GET_SIZE(HDRP(bp)) + GET_SIZE(HDRP(next));
+    PUT(HDRP(bp), PACK(csize, 1) | GET_PREV_ALLOC(HDRP(bp)));
+    SET_PREV_ALLOC(NEXT_BLKP(bp));
+    shrink_block(ar, bp, asize);
+    ar->free_low = MIN(ar->free_low, ar->free_bytes);
+    
+    if (extended) {
+        ar->stats.realloc_extend++;
+    }
+    else {
+        ar->stats.realloc_grow++;
+    }
+    return 1;
+}
+
+/*
+ * find_free - Find a fit for a block with asize bytes. If nothing fits while blocks wait on the quick lists, coalesce
+ *             them and search again
+ */
+static void *find_free(arena_t *ar, size_t asize) {
+    char *bp;
+
+    if ((bp = find_fit(ar, asize)) == NULL && ar->quick_count > 0) {
+        consolidate(ar);
+        bp = find_fit(ar, asize);
+    }
+    return bp;
+}
+
+/*
+ * consolidate - Free every block on arena ar's quick lists for real, coalescing each with its free neighbours. A
+ *               neighbour still on a quick list looks allocated; it merges when its own turn comes. Called with the
+ *               arena lock held
+ */
+static void consolidate(arena_t *ar) {
+    size_t size;
+    char *bp;
+    int i;
+
+    if (ar->quick_count == 0) {
+        return;
+    }
+    for (i = 0; i < QUICK_BINS; i++) {
+        while ((bp = ar->quick[i]) != NULL) {
+            ar->quick[i] = PRED(bp);
+            size = GET_SIZE(HDRP(bp));
+            PUT(HDRP(bp), PACK(size, 0) | GET_PREV_ALLOC(HDRP(bp)));
+            PUT(FTRP(bp), PACK(size, 0));
+            CLR_PREV_ALLOC(NEXT_BLKP(bp));
+            coalesce(ar, bp);
+        }
+    }
+    ar->quick_count = 0;
+    ar->stats.quick_sweeps++;
+}
+
+/*
+ * find_fit - Find a fit for a block with asize bytes using the current placement policy
  */
 /* $begin mmfirstfit */
 /* $begin mmfirstfit-proto */
-static void *find_fit(size_t asize) {
+static void *find_fit(arena_t *ar, size_t asize) {
 /* $end mmfirstfit-proto */
 /* $end mmfirstfit */
-	#ifdef NEXT_FIT
+    char *bp;
+
+    switch (fit_policy) {
+    case MM_FIRSTFIT:
+	/* $begin mmfirstfit */
+		/* First fit search */
+		for (bp = ar->heap_listp; GET_SIZE(HDRP(bp)) > 0; bp = NEXT_BLKP(bp)) {
+			if (!GET_ALLOC(HDRP(bp)) && (asize <= GET_SIZE(HDRP(bp)))) {
+				return bp;
+			}
+		}
+		return NULL; /* No fit */
+	/* $end mmfirstfit */
+
+    case MM_NEXTFIT: {
 		/* Next fit search */
-		char *oldrover = rover;
-        char *bp;
-        int index = 0;
-        size_t size = ((FTRP(rover) + 4)-HDRP(rover));
-
-        int i = 0;
-        for (bp = heap_listp; GET_SIZE(HDRP(bp)) > 0; bp = NEXT_BLKP(bp)) {
-            if ((!GET_ALLOC(rover)) && (((FTRP(bp) + 4)-HDRP(bp)) <= size)) {
-                size = ((FTRP(bp) + 4)-HDRP(bp));
-                index = i;
-            }
-            i++;
-        }
-        return blockArray[index];
-    
+		char *oldrover = ar->rover;
+
 		/* Search from the rover to the end of list */
-		/*for ( ; GET_SIZE(HDRP(rover)) > 0; rover = NEXT_BLKP(rover)) {
-			if (!GET_ALLOC(HDRP(rover)) && (asize <= GET_SIZE(HDRP(rover)))) {
-				return rover;
+		for ( ; GET_SIZE(HDRP(ar->rover)) > 0; ar->rover = NEXT_BLKP(ar->rover)) {
+			if (!GET_ALLOC(HDRP(ar->rover)) && (asize <= GET_SIZE(HDRP(ar->rover)))) {
+				return ar->rover;
 			}
-		}*/
+		}
 
 		/* search from start of list to old rover */
-		/*for (rover = heap_listp; rover < oldrover; rover = NEXT_BLKP(rover)) {
-			if (!GET_ALLOC(HDRP(rover)) && (asize <= GET_SIZE(HDRP(rover)))) {
-				return rover;
+		for (ar->rover = ar->heap_listp; ar->rover < oldrover; ar->rover = NEXT_BLKP(ar->rover)) {
+			if (!GET_ALLOC(HDRP(ar->rover)) && (asize <= GET_SIZE(HDRP(ar->rover)))) {
+				return ar->rover;
 			}
 		}
+		return NULL;  /* no fit found */
+    }
 
-		return NULL;*/  /* no fit found */
-	#else
-	/* $begin mmfirstfit */
-		/* First fit search */
-		void *bp;
+    case MM_BESTFIT:
+		/*
+		 * Best fit search. Splaying on (asize, 0) leaves either the smallest block of at least asize bytes or
+		 * its predecessor at the root; in the latter case the best fit is the leftmost node of the right subtree.
+		 */
+		if (ar->free_tree == NULL) {
+			return NULL;
+		}
+		ar->free_tree = splay(ar->free_tree, asize, NULL);
+		if (GET_SIZE(HDRP(ar->free_tree)) >= asize) {
+			return ar->free_tree;
+		}
+		bp = RIGHT(ar->free_tree);
+		while (bp != NULL && LEFT(bp) != NULL) {
+			bp = LEFT(bp);
+		}
+		return bp; /* NULL if no fit */
 
-		for (bp = heap_listp; GET_SIZE(HDRP(bp)) > 0; bp = NEXT_BLKP(bp)) {
-			if (!GET_ALLOC(HDRP(bp)) && (asize <= GET_SIZE(HDRP(bp)))) {
-				return bp;
+    default: {
+		/*
+		 * Segregated first fit search. Start at the size class of asize and take the first block that is big
+		 * enough. Every block in a larger class is big enough, so past the home class the head of the first
+		 * non-empty list is the answer.
+		 */
+		int class;
+
+		for (class = size_class(asize); class < NUM_CLASSES; class++) {
+			for (bp = ar->free_lists[class]; bp != NULL; bp = SUCC(bp)) {
+				if (asize <= GET_SIZE(HDRP(bp))) {
+					return bp;
+				}
 			}
 		}
 		return NULL; /* No fit */
-	/* $end mmfirstfit */
-	#endif
+    }
+    }
+}
+
+/*
+ * size_class - Map a block size to its segregated free list. Class 0 holds blocks up to 32 bytes, class i holds
+ *              blocks in (32 << (i-1), 32 << i], and the last class holds everything larger.
+ */
+static int size_class(size_t asize) {
+    int class = 0;
+    size_t limit = 32;
+
+    while (class < NUM_CLASSES - 1 && asize > limit) {
+        limit <<= 1;
+        class++;
+    }
+    return class;
+}
+
+/*
+ * insert_free - Add free block bp to the free index of the current policy. In segregated fit it is pushed onto
+ *               the head of the list for its size (LIFO order); in best fit it becomes the root of the splay tree.
+ */
+static void insert_free(arena_t *ar, void *bp) {
+    size_t size = GET_SIZE(HDRP(bp));
+    int class;
+    char *t;
+
+    ar->free_bytes += size;
+
+    switch (fit_policy) {
+    case MM_BESTFIT:
+        if (ar->free_tree == NULL) {
+            LEFT(bp) = RIGHT(bp) = NULL;
+        }
+        else {
+            /* Split the tree around bp and make bp the new root */
+            t = splay(ar->free_tree, size, bp);
+            if (KEY_CMP(size, bp, t) < 0) {
+                LEFT(bp) = LEFT(t);
+                RIGHT(bp) = t;
+                LEFT(t) = NULL;
+            }
+            else {
+                RIGHT(bp) = RIGHT(t);
+                LEFT(bp) = t;
+                RIGHT(t) = NULL;
+            }
+        }
+        ar->free_tree = bp;
+        break;
+
+    case MM_SEGFIT:
+        class = size_class(size);
+        PRED(bp) = NULL;
+        SUCC(bp) = ar->free_lists[class];
+        if (ar->free_lists[class] != NULL) {
+            PRED(ar->free_lists[class]) = bp;
+        }
+        ar->free_lists[class] = bp;
+        break;
+
+    default:
+        break;  /* The implicit list policies find free blocks by walking the heap */
+    }
+}
+
+/*
+ * remove_free - Remove free block bp from the free index of the current policy
+ */
+static void remove_free(arena_t *ar, void *bp) {
+    size_t size = GET_SIZE(HDRP(bp));
+    char *t;
+
+    ar->free_bytes -= size;
+
+    switch (fit_policy) {
+    case MM_BESTFIT:
+        t = splay(ar->free_tree, size, bp);   /* t == bp */
+        if (LEFT(t) == NULL) {
+            ar->free_tree = RIGHT(t);
+        }
+        else {
+            /* bp's key is larger than everything on its left, so splaying it there lifts the maximum to the root */
+            ar->free_tree = splay(LEFT(t), size, bp);
+            RIGHT(ar->free_tree) = RIGHT(t);
+        }
+        break;
+
+    case MM_SEGFIT:
+        if (PRED(bp) != NULL) {
+            SUCC(PRED(bp)) = SUCC(bp);
+        }
+        else {
+            ar->free_lists[size_class(size)] = SUCC(bp);
+        }
+        if (SUCC(bp) != NULL) {
+            PRED(SUCC(bp)) = PRED(bp);
+        }
+        break;
+
+    default:
+        break;
+    }
+}
+
+/*
+ * rebuild_free_index - Empty every free index and re-add each free block in the heap under the current policy
+ */
+static void rebuild_free_index(arena_t *ar) {
+    char *bp;
+    int i;
+
+    for (i = 0; i < NUM_CLASSES; i++) {
+        ar->free_lists[i] = NULL;
+    }
+    ar->free_tree = NULL;
+    ar->rover = ar->heap_listp;
+    ar->free_bytes = 0;
+    for (bp = ar->heap_listp; GET_SIZE(HDRP(bp)) > 0; bp = NEXT_BLKP(bp)) {
+        if (!GET_ALLOC(HDRP(bp))) {
+            insert_free(ar, bp);
+        }
+    }
+    ar->free_low = ar->free_bytes;
+}
+
+#if MM_THREADSAFE
+/*
+ * heap_once_init - Create the arena locks and the key whose destructor flushes an exiting thread's cache
+ */
+static void heap_once_init(void) {
+    int i;
+
+    for (i = 0; i < NARENAS; i++) {
+        Sem_init(&arenas[i].mutex, 0, 1);
+    }
+    Sem_init(&handle_mutex, 0, 1);
+    Sem_init(&pool_mutex, 0, 1);
+    pthread_key_create(&tcache_key, tcache_destroy);
+    pthread_atfork(fork_prepare, fork_release, fork_release);
+}
+
+/*
+ * fork_prepare - Take every allocator lock before fork, so that the child does not inherit a lock held by a thread
+ *                that does not exist in it. Locks are taken in the order the rest of the allocator nests them
+ */
+static void fork_prepare(void) {
+    mm_pool_t *p;
+    int i;
+
+    P(&handle_mutex);
+    P(&pool_mutex);
+    for (p = pools; p != NULL; p = p->next) {
+        P(&p->mutex);
+    }
+    for (i = 0; i < NARENAS; i++) {
+        P(&arenas[i].mutex);
+    }
+}
+
+/*
+ * fork_release - Drop the locks taken by fork_prepare, in the parent and in the child. The threads whose caches
+ *                the child inherits are gone; those blocks simply stay allocated
+ */
+static void fork_release(void) {
+    mm_pool_t *p;
+    int i;
+
+    for (i = NARENAS - 1; i >= 0; i--) {
+        V(&arenas[i].mutex);
+    }
+    for (p = pools; p != NULL; p = p->next) {
+        V(&p->mutex);
+    }
+    V(&pool_mutex);
+    V(&handle_mutex);
+}
+
+/*
+ * tcache_get - Pop a cached block of exactly asize bytes for this thread. An empty bin is refilled with
+ *              TCACHE_MAX/2 blocks under a single acquisition of an arena lock. Returns NULL if asize is too
+ *              large to cache or the heap is out of memory.
+ */
+static void *tcache_get(size_t asize) {
+    size_t bin = (asize - SLAB_ALIGN) / DSIZE;
+    arena_t *ar;
+    char *bp;
+    int i;
+    
+    if (bin >= TCACHE_BINS) {
+        return NULL;
+    }
+    if (tcache_generation != heap_generation) {
+        /* mm_init replaced the heap these blocks came from; forget them */
+        for (i = 0; i < TCACHE_BINS; i++) {
+            tcache[i] = NULL;
+            tcache_count[i] = 0;
+        }
+        tcache_generation = heap_generation;
+    }
+    
+    if (tcache[bin] == NULL) {
+        ar = arena_get();
+        for (i = 0; i < TCACHE_MAX/2; i++) {
+            if ((bp = heap_malloc(ar, asize)) == NULL) {
+                break;
+            }
+            PRED(bp) = tcache[bin];
+            tcache[bin] = bp;
+            tcache_count[bin]++;
+        }
+        ar->stats.tcache_refill++;
+        UNLOCK(ar);
+        pthread_setspecific(tcache_key, (void *)1);
+        if (tcache[bin] == NULL) {
+            return NULL;
+        }
+    }
+    
+    bp = tcache[bin];
+    tcache[bin] = PRED(bp);
+    tcache_count[bin]--;
+    return bp;
+}
+
+/*
+ * tcache_put - Cache allocated block bp for this thread instead of freeing it. A full bin first flushes half of
+ *              its blocks back to the heap. Returns 0 if bp is too large to cache.
+ */
+static int tcache_put(void *bp) {
+    size_t size = IN_SLAB(bp) ? SLAB_OF(bp)->size : GET_SIZE(HDRP(bp));
+    size_t bin = (size - SLAB_ALIGN) / DSIZE;
+    
+    if (bin >= TCACHE_BINS || tcache_generation != heap_generation) {
+        return 0;
+    }
+    
+    /* A heap block shrunk to a slot size has less payload than the slot tcache_get would promise */
+    if (size <= SLAB_MAX && !IN_SLAB(bp)) {
+        return 0;
+    }
+    if (tcache_count[bin] >= TCACHE_MAX) {
+        tcache_flush(bin, TCACHE_MAX/2);
+    }
+    PRED(bp) = tcache[bin];
+    tcache[bin] = bp;
+    tcache_count[bin]++;
+    return 1;
+}
+
+/*
+ * tcache_flush - Free up to count of this thread's cached blocks in bin back to the arenas that own them. The
+ *                owner's lock is held across runs of blocks from the same arena.
+ */
+static void tcache_flush(int bin, int count) {
+    arena_t *ar = NULL, *owner;
+    char *bp;
+    
+    while (count-- > 0 && (bp = tcache[bin]) != NULL) {
+        tcache[bin] = PRED(bp);
+        tcache_count[bin]--;
+        owner = arena_of(bp);
+        if (owner != ar) {
+            if (ar != NULL) {
+                UNLOCK(ar);
+            }
+            ar = owner;
+            LOCK(ar);
+            ar->stats.tcache_flush++;
+        }
+        heap_free(ar, bp);
+    }
+    if (ar != NULL) {
+        UNLOCK(ar);
+    }
+}
+
+/*
+ * tcache_destroy - Key destructor run at thread exit: return every cached block to the heap
+ */
+static void tcache_destroy(void *unused) {
+    int i;
+    
+    (void)unused;
+    if (tcache_generation != heap_generation) {
+        return;
+    }
+    for (i = 0; i < TCACHE_BINS; i++) {
+        tcache_flush(i, tcache_count[i]);
+    }
+}
+#endif
+
+/*
+ * splay - Top-down splay of the tree rooted at t around the key (size, addr). Returns the new root, which is the
+ *         node with that key if present, else its predecessor or successor.
+ */
+static char *splay(char *t, size_t size, char *addr) {
+    char *header[2];                   /* Stands in for a node: header[0] is LEFT, header[1] is RIGHT */
+    char *n = (char *)header;
+    char *l = n, *r = n, *y;
+
+    if (t == NULL) {
+        return t;
+    }
+    LEFT(n) = RIGHT(n) = NULL;
+    
+    for (;;) {
+        if (KEY_CMP(size, addr, t) < 0) {
+            if (LEFT(t) == NULL) {
+                break;
+            }
+            if (KEY_CMP(size, addr, LEFT(t)) < 0) {   /* Rotate right */
+                y = LEFT(t);
+                LEFT(t) = RIGHT(y);
+                RIGHT(y) = t;
+                t = y;
+                if (LEFT(t) == NULL) {
+                    break;
+                }
+            }
+            LEFT(r) = t;                                /* Link right */
+            r = t;
+            t = LEFT(t);
+        }
+        else if (KEY_CMP(size, addr, t) > 0) {
+            if (RIGHT(t) == NULL) {
+                break;
+            }
+            if (KEY_CMP(size, addr, RIGHT(t)) > 0) {  /* Rotate left */
+                y = RIGHT(t);
+                RIGHT(t) = LEFT(y);
+                LEFT(y) = t;
+                t = y;
+                if (RIGHT(t) == NULL) {
+                    break;
+                }
+            }
+            RIGHT(l) = t;                               /* Link left */
+            l = t;
+            t = RIGHT(t);
+        }
+        else {
+            break;
+        }
+    }
+    
+    /* Reassemble */
+    RIGHT(l) = LEFT(t);
+    LEFT(r) = RIGHT(t);
+    LEFT(t) = RIGHT(n);
+    RIGHT(t) = LEFT(n);
+    return t;
 }
 
-static void printblock(void *bp)
+static void printblock(arena_t *ar, void *bp)
 {
     size_t hsize, halloc, fsize, falloc;
     
-    checkheap(0);
+    checkheap(ar, 0);
     hsize = GET_SIZE(HDRP(bp));
     halloc = GET_ALLOC(HDRP(bp));
-    fsize = GET_SIZE(FTRP(bp));
-    falloc = GET_ALLOC(FTRP(bp));
     
     if (hsize == 0) {
 		printf("%p: EOL\n", bp);
 		return;
     }
+    /* Only free blocks have a footer */
+    fsize = halloc ? hsize : GET_SIZE(FTRP(bp));
+    falloc = halloc ? halloc : GET_ALLOC(FTRP(bp));
     
     /*printf("%p: header: [%p:%c] footer: [%p:%c]\n", bp,
      hsize, (halloc ? 'a' : 'f'),
@@ -550,10 +2729,10 @@ static void printblock(void *bp)
 
 static void checkblock(void *bp)
 {
-    if ((size_t)bp % 8) {
+    if ((size_t)bp % DSIZE) {
 		printf("Error: %p is not doubleword aligned\n", bp);
 	}
-    if (GET(HDRP(bp)) != GET(FTRP(bp))) {
+    if (!GET_ALLOC(HDRP(bp)) && GET_SIZE(HDRP(bp)) != GET_SIZE(FTRP(bp))) {
 		printf("Error: header does not match footer\n");
 	}
 }
@@ -561,25 +2740,105 @@ static void checkblock(void *bp)
 /*
  * checkheap - Minimal check of the heap for consistency
  */
-void checkheap(int verbose)
+void checkheap(arena_t *ar, int verbose)
 {
-    char *bp = heap_listp;
+    char *bp = ar->heap_listp;
+    int class, free_blocks = 0, listed_blocks = 0, quick_blocks = 0;
+    size_t free_bytes = 0;
     
     if (verbose)
-        printf("Heap (%p):\n", heap_listp);
+        printf("Heap (%p):\n", ar->heap_listp);
     
-    if ((GET_SIZE(HDRP(heap_listp)) != DSIZE) || !GET_ALLOC(HDRP(heap_listp)))
+    if ((GET_SIZE(HDRP(ar->heap_listp)) != DSIZE) || !GET_ALLOC(HDRP(ar->heap_listp)))
         printf("Bad prologue header\n");
-    checkblock(heap_listp);
+    checkblock(ar->heap_listp);
     
-    for (bp = heap_listp; GET_SIZE(HDRP(bp)) > 0; bp = NEXT_BLKP(bp)) {
+    for (bp = ar->heap_listp; GET_SIZE(HDRP(bp)) > 0; bp = NEXT_BLKP(bp)) {
         if (verbose)
-            printblock(bp);
+            printblock(ar, bp);
         checkblock(bp);
+        if (!GET_PREV_ALLOC(HDRP(NEXT_BLKP(bp))) != !GET_ALLOC(HDRP(bp)))
+            printf("Error: prev-allocated bit after %p is wrong\n", bp);
     }
     
     if (verbose)
-        printblock(bp);
+        printblock(ar, bp);
     if ((GET_SIZE(HDRP(bp)) != 0) || !(GET_ALLOC(HDRP(bp))))
         printf("Bad epilogue header\n");
-}
\ No newline at end of file
+
+    /* Blocks waiting on a quick list are still marked allocated */
+    for (class = 0; class < QUICK_BINS; class++) {
+        for (bp = ar->quick[class]; bp != NULL; bp = PRED(bp)) {
+            if (!GET_ALLOC(HDRP(bp)) || GET_SIZE(HDRP(bp)) != (size_t)class * DSIZE)
+                printf("Error: %p is on the wrong quick list\n", bp);
+            quick_blocks++;
+        }
+    }
+    if (quick_blocks != ar->quick_count)
+        printf("Error: %d blocks on quick lists but count is %d\n", quick_blocks, ar->quick_count);
+
+    /* Every free block in the heap must be on exactly the free list for its size */
+    for (bp = ar->heap_listp; GET_SIZE(HDRP(bp)) > 0; bp = NEXT_BLKP(bp)) {
+        if (!GET_ALLOC(HDRP(bp))) {
+            free_blocks++;
+            free_bytes += GET_SIZE(HDRP(bp));
+        }
+    }
+    if (free_bytes != ar->free_bytes || ar->free_low > ar->free_bytes)
+        printf("Error: %zu free bytes in heap but count is %zu (low %zu)\n", free_bytes, ar->free_bytes, ar->free_low);
+    if (fit_policy == MM_BESTFIT) {
+        listed_blocks = checktree(ar->free_tree);
+    }
+    for (class = 0; class < NUM_CLASSES; class++) {
+        for (bp = ar->free_lists[class]; bp != NULL; bp = SUCC(bp)) {
+            if (GET_ALLOC(HDRP(bp)) || size_class(GET_SIZE(HDRP(bp))) != class)
+                printf("Error: %p is on the wrong free list\n", bp);
+            if (SUCC(bp) != NULL && PRED(SUCC(bp)) != bp)
+                printf("Error: free list links around %p are inconsistent\n", bp);
+            listed_blocks++;
+        }
+    }
+    if (fit_policy != MM_SEGFIT && fit_policy != MM_BESTFIT)
+        return;  /* No free index to compare against */
+    if (free_blocks != listed_blocks)
+        printf("Error: %d free blocks in heap but %d on free lists\n", free_blocks, listed_blocks);
+}
+/*
+ * checktree - Check that the splay tree rooted at t only holds free blocks in key order. Returns its node count
+ */
+static int checktree(char *t)
+{
+    if (t == NULL)
+        return 0;
+    if (GET_ALLOC(HDRP(t)))
+        printf("Error: allocated block %p is in the free tree\n", t);
+    if (LEFT(t) != NULL && KEY_CMP(GET_SIZE(HDRP(LEFT(t))), LEFT(t), t) >= 0)
+        printf("Error: free tree out of order at %p\n", t);
+    if (RIGHT(t) != NULL && KEY_CMP(GET_SIZE(HDRP(RIGHT(t))), RIGHT(t), t) <= 0)
+        printf("Error: free tree out of order at %p\n", t);
+    return 1 + checktree(LEFT(t)) + checktree(RIGHT(t));
+}
+
+/*
+ * checkslabs - Check the slabs on arena ar's lists against their bitmaps
+ */
+static void checkslabs(arena_t *ar)
+{
+    slab_t *s;
+    unsigned int i, nfree;
+    int cls;
+
+    for (cls = 0; cls < SLAB_CLASSES; cls++) {
+        for (s = ar->slabs[cls]; s != NULL; s = s->next) {
+            nfree = 0;
+            for (i = 0; i < SLAB_WORDS; i++)
+                nfree += __builtin_popcountll(s->map[i]);
+            if (s->ar != ar || s->size != (unsigned int)(cls + 1) * SLAB_ALIGN)
+                printf("Error: slab %p is on the wrong list\n", s);
+            if (nfree != s->nfree || nfree == 0)
+                printf("Error: slab %p has %u free slots but counts %u\n", s, nfree, s->nfree);
+            if (s->next != NULL && s->next->prev != s)
+                printf("Error: slab list links around %p are inconsistent\n", s);
+        }
+    }
+}
@@ -13,13 +13,83 @@ void mm_free(void *bp);
 
 void mm_checkheap(int verbose);
 void *mm_realloc(void *ptr, size_t size);
+void *mm_calloc(size_t nmemb, size_t size);
+void *mm_memalign(size_t alignment, size_t size);
+void *mm_aligned_alloc(size_t alignment, size_t size);
+int mm_posix_memalign(void **memptr, size_t alignment, size_t size);
+size_t mm_usable_size(void *ptr);
+size_t mm_malloc_batch(size_t size, size_t count, void **out);
+void mm_free_batch(void **ptrs, size_t count);
 void mm_printblocklist(void);
 unsigned long mm_getpayloadsize(int blocknumber);
 void mm_writeheap(int blocknumber, char character, int numberOfRepetitions);
 void mm_printheap(int blocknumber, int numberOfBytesToRead);
 char* mm_blocknumbertoblock(int blocknumber);
 void mm_freebufferinblock(char* bp);
-void *getBlockArrayElement(int blockNumber);
+
+/* Block handles: small integers naming allocated blocks, recycled once freed */
+int mm_halloc(size_t size);
+void *mm_hget(int h);
+void mm_hfree(int h);
+
+/* Regions (mmregion.c): bump allocation from heap chunks, freed all at once. A region is not thread-safe */
+typedef struct mm_region mm_region_t;
+
+mm_region_t *mm_region_create(size_t chunk_size);
+void *mm_region_alloc(mm_region_t *r, size_t size);
+void mm_region_reset(mm_region_t *r);
+void mm_region_destroy(mm_region_t *r);
+
+/* Object pools: fixed-size objects carved from slabs of the main heap, with O(1) alloc and free */
+typedef struct mm_pool mm_pool_t;
+
+mm_pool_t *mm_pool_create(size_t objsize, size_t align);
+void *mm_pool_alloc(mm_pool_t *p);
+void mm_pool_free(mm_pool_t *p, void *obj);
+int mm_pool_prewarm(mm_pool_t *p, size_t count);
+void mm_pool_destroy(mm_pool_t *p);
+
+/* Placement policies for mm_set_policy */
+#define MM_FIRSTFIT 0   /* First fit over the implicit block list */
+#define MM_NEXTFIT  1   /* Next fit over the implicit block list, resuming at a rover */
+#define MM_BESTFIT  2   /* Exact best fit from a size-ordered splay tree of free blocks */
+#define MM_SEGFIT   3   /* First fit within segregated size class free lists (default) */
+
+int mm_set_policy(int policy);
+int mm_get_policy(void);
+
+/* Options for mm_setopt */
+#define MM_OPT_MMAP_THRESHOLD 0   /* Requests of at least this many bytes are mapped directly; 0 never maps */
+#define MM_OPT_TRIM_THRESHOLD 1   /* A free block this large at the top of a heap is trimmed; 0 never trims */
+#define MM_OPT_RELEASE_THRESHOLD 2 /* Growth of free memory that triggers a sweep releasing free pages; 0 never sweeps */
+#define MM_OPT_QUICK_MAX 3        /* Largest block size (at most MM_QUICK_MAX) coalesced lazily; 0 coalesces at once */
+
+int mm_setopt(int opt, size_t value);
+int mm_trim(size_t pad);
+
+/* Allocator counters reported by mm_getstats */
+typedef struct {
+    unsigned long realloc_shrink;   /* mm_realloc calls satisfied by shrinking in place */
+    unsigned long realloc_grow;     /* ... by absorbing a free successor */
+    unsigned long realloc_extend;   /* ... by extending the heap behind the last block */
+    unsigned long realloc_copy;     /* ... by falling back to allocate, copy and free */
+    unsigned long tcache_refill;    /* Per-thread cache bins refilled from the heap (MM_THREADSAFE) */
+    unsigned long tcache_flush;     /* Per-thread cache bins flushed back to the heap (MM_THREADSAFE) */
+    unsigned long mmap_alloc;       /* Large blocks mapped directly */
+    unsigned long mmap_free;        /* Large blocks unmapped */
+    unsigned long trim_bytes;       /* Bytes trimmed off the top of a heap */
+    unsigned long release_sweeps;   /* Sweeps releasing the pages inside free blocks */
+    unsigned long calloc_fresh;     /* mm_calloc blocks that needed no zeroing */
+    unsigned long quick_hits;       /* Heap requests served from a quick list */
+    unsigned long quick_sweeps;     /* Sweeps coalescing the blocks on the quick lists */
+    unsigned long pool_alloc;       /* Objects allocated from pools */
+    unsigned long pool_free;        /* Objects freed to pools */
+    unsigned long pool_slabs;       /* Slabs taken from the heap by pools */
+} mm_stats_t;
+
+void mm_getstats(mm_stats_t *stats);
+size_t mm_footprint(void);
+void mm_printstats(void);
 
 /* Unused. Just to keep us compatible with the 15-213 malloc driver */
 typedef struct {
@@ -0,0 +1,139 @@
+/*
+ * Ian Stephenson   - 44419093
+ * Pok On Cheng     - 75147306
+ * Sung Mo Koo      - 51338217
+ * Cassie Liu       - 52504836
+ */
+
+/*
+ * mmregion.c - Regions on top of the heap. A region takes chunks from
+ * mm_malloc and hands out objects by bumping a pointer through the current
+ * chunk; objects are never freed one by one. mm_region_reset gives back
+ * every chunk but the first in one pass and rewinds the pointer, so a
+ * request handler can drop hundreds of objects at the cost of a few
+ * mm_free calls. It is mem_reset_brk for a single request. A region is
+ * not thread-safe; give each thread or request its own.
+ */
+#include <stddef.h>
+#include <stdint.h>
+
+#include "mm.h"
+
+#define REGION_CHUNK (16*1024)  /* Default chunk size (bytes) */
+#define REGION_ALIGN 16         /* Objects are aligned to this */
+
+/* Round p up to a multiple of REGION_ALIGN */
+#define ALIGN_UP(p)  (((uintptr_t)(p) + (REGION_ALIGN-1)) & ~(uintptr_t)(REGION_ALIGN-1))
+
+typedef struct region_chunk {
+    struct region_chunk *next;  /* Chunks after the first, newest first */
+} region_chunk_t;
+
+struct mm_region {
+    region_chunk_t *chunks;     /* Extra chunks, freed by mm_region_reset */
+    char *cur;                  /* Next free byte of the current chunk */
+    char *end;                  /* End of the current chunk */
+    char *base;                 /* First object byte of the first chunk, which is part of this block */
+    size_t chunk_size;          /* Bytes of objects per chunk */
+};
+
+/* Function prototypes for internal helper routines */
+static void *chunk_alloc(mm_region_t *r, size_t size);
+
+/*
+ * mm_region_create - Create a region that grows in chunks of chunk_size bytes, REGION_CHUNK if 0. The first chunk
+ *                    shares a block with the region itself. Returns NULL if out of memory
+ */
+mm_region_t *mm_region_create(size_t chunk_size) {
+    mm_region_t *r;
+
+    if (chunk_size == 0) {
+        chunk_size = REGION_CHUNK;
+    }
+    if (chunk_size > (size_t)-1 - sizeof(mm_region_t) - REGION_ALIGN) {
+        return NULL;
+    }
+    if ((r = mm_malloc(sizeof(mm_region_t) + REGION_ALIGN + chunk_size)) == NULL) {
+        return NULL;
+    }
+    r->chunks = NULL;
+    r->base = r->cur = (char *)ALIGN_UP(r + 1);
+    r->end = r->cur + chunk_size;
+    r->chunk_size = chunk_size;
+    return r;
+}
+
+/*
+ * mm_region_alloc - Allocate size bytes from region r. Returns NULL for a zero size or if out of memory
+ */
+void *mm_region_alloc(mm_region_t *r, size_t size) {
+    char *p;
+
+    if (size == 0 || size > (size_t)-1 - REGION_ALIGN) {
+        return NULL;
+    }
+    size = ALIGN_UP(size);
+
+    /* Fast path: bump within the current chunk */
+    if (size <= (size_t)(r->end - r->cur)) {
+        p = r->cur;
+        r->cur += size;
+        return p;
+    }
+    return chunk_alloc(r, size);
+}
+
+/*
+ * mm_region_reset - Free every object in region r at once. The first chunk is kept for the next round
+ */
+void mm_region_reset(mm_region_t *r) {
+    region_chunk_t *c;
+
+    while ((c = r->chunks) != NULL) {
+        r->chunks = c->next;
+        mm_free(c);
+    }
+    r->cur = r->base;
+    r->end = r->base + r->chunk_size;
+}
+
+/*
+ * mm_region_destroy - Free region r and every object in it
+ */
+void mm_region_destroy(mm_region_t *r) {
+    if (r == NULL) {
+        return;
+    }
+    mm_region_reset(r);
+    mm_free(r);
+}
+
+/*
+ * The remaining routines are internal helper routines
+ */
+
+/*
+ * chunk_alloc - Allocate size bytes, a multiple of REGION_ALIGN, from a new chunk of region r. An object larger
+ *               than a quarter chunk gets a chunk of its own, so the rest of the current chunk stays in use.
+ *               Returns NULL if out of memory
+ */
+static void *chunk_alloc(mm_region_t *r, size_t size) {
+    region_chunk_t *c;
+    size_t csize = size > r->chunk_size / 4 ? size : r->chunk_size;
+    char *p;
+
+    if (csize > (size_t)-1 - sizeof(region_chunk_t) - REGION_ALIGN) {
+        return NULL;
+    }
+    if ((c = mm_malloc(sizeof(region_chunk_t) + REGION_ALIGN + csize)) == NULL) {
+        return NULL;
+    }
+    c->next = r->chunks;
+    r->chunks = c;
+    p = (char *)ALIGN_UP(c + 1);
+    if (csize == r->chunk_size) {
+        r->cur = p + size;
+        r->end = p + csize;
+    }
+    return p;
+}
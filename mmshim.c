@@ -0,0 +1,333 @@
+/*
+ * Ian Stephenson   - 44419093
+ * Pok On Cheng     - 75147306
+ * Sung Mo Koo      - 51338217
+ * Cassie Liu       - 52504836
+ */
+
+/*
+ * mmshim.c - Run unmodified programs on this allocator. Built into a
+ * shared library and loaded with LD_PRELOAD, it replaces the C library's
+ * malloc family with the mm.h API:
+ *
+ *     gcc -O2 -fPIC -shared -fvisibility=hidden -I. -DMM_THREADSAFE=1 \
+ *         -DMM_WIDE_TAGS=1 mmshim.c mm.c memlib.c csapp.c -o libmm.so -lpthread
+ *     LD_PRELOAD=./libmm.so ls -l
+ *
+ * Only the functions below are exported; the allocator itself stays
+ * hidden, so it cannot collide with the program's own symbols.
+ *
+ * The heap is set up by the first call. Anything the setup itself asks
+ * for, and any other call made on that thread before it finishes, is
+ * carved from a small static buffer instead, and frees of that memory are
+ * ignored. Other threads wait for the setup to finish; if it fails, every
+ * thread is served from that buffer until it runs out. The shim never
+ * looks up the C library's malloc with dlsym, so the usual recursion
+ * through dlsym's own calloc cannot happen, and every pointer handed out
+ * is one this file can free. Across fork, mm.c takes every allocator lock
+ * so the child starts with a consistent heap.
+ *
+ * The C library's conventions differ from mm_malloc's in a few places:
+ * malloc(0) returns a unique pointer, failures set errno to ENOMEM, and
+ * realloc(ptr, 0) frees ptr. Every block is aligned to 16 bytes, which the
+ * C library promises (alignof(max_align_t)) and SSE code and long double
+ * rely on, so the shim is built with wide tags, under which every block
+ * is aligned that far.
+ *
+ * Built with -DMM_TRACE=1 (and mmtrace.c), the shim records every call of
+ * the program into the file named by MM_TRACE_FILE, with timestamps if
+ * MM_TRACE_TIMED is set. trace2rep turns the file into a .rep trace.
+ */
+#include "config.h"
+
+#if !MM_THREADSAFE
+#error "mmshim.c needs the thread-safe allocator; build with -DMM_THREADSAFE=1"
+#endif
+#if !MM_WIDE_TAGS
+#error "mmshim.c needs 16-byte aligned blocks; build with -DMM_WIDE_TAGS=1"
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sched.h>
+#include <unistd.h>
+
+#include "mm.h"
+#include "memlib.h"
+#include "mmtrace.h"
+
+#define SHIM_EXPORT __attribute__((visibility("default")))
+
+#define SHIM_ALIGN 16            /* Minimum alignment of every block, alignof(max_align_t) */
+#define BOOT_SIZE  (64*1024)     /* Bytes for allocations made while the heap is being set up */
+
+/* Setup states */
+#define SHIM_NONE  0
+#define SHIM_BUSY  1
+#define SHIM_READY 2
+#define SHIM_FAILED 3            /* mm_init failed; everything comes from the bootstrap buffer */
+
+/* Global variables */
+static int shim_state = SHIM_NONE;
+static __thread int shim_initializing;      /* Set on the thread doing the setup */
+static char boot_buf[BOOT_SIZE] __attribute__((aligned(SHIM_ALIGN)));
+static size_t boot_top;                      /* Bytes of boot_buf handed out */
+
+/* Returns true if p points into the bootstrap buffer */
+#define IN_BOOT(p)  ((char *)(p) >= boot_buf && (char *)(p) < boot_buf + BOOT_SIZE)
+
+/* Size of the bootstrap block at p, kept in the word before it */
+#define BOOT_SIZEOF(p)  (((size_t *)(p))[-1])
+
+/* Function prototypes for internal helper routines */
+static int shim_init(void);
+static void *boot_alloc(size_t size, size_t align);
+static void *shim_memalign(size_t align, size_t size);
+#if MM_TRACE
+static void shim_trace_stop(void) __attribute__((destructor));
+#endif
+
+/*
+ * malloc - Allocate size bytes. A zero size still gets its own block
+ */
+SHIM_EXPORT void *malloc(size_t size) {
+    void *p;
+
+    if (!shim_init()) {
+        return boot_alloc(size, SHIM_ALIGN);
+    }
+    if ((p = mm_malloc(size ? size : 1)) == NULL) {
+        errno = ENOMEM;
+    }
+    return p;
+}
+
+/*
+ * free - Free ptr. Bootstrap blocks are never reused
+ */
+SHIM_EXPORT void free(void *ptr) {
+    if (ptr == NULL || IN_BOOT(ptr)) {
+        return;
+    }
+    mm_free(ptr);
+}
+
+/*
+ * calloc - Allocate a zeroed array of nmemb elements of size bytes
+ */
+SHIM_EXPORT void *calloc(size_t nmemb, size_t size) {
+    void *p;
+
+    if (size != 0 && nmemb > (size_t)-1 / size) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    if (!shim_init()) {
+        return boot_alloc(nmemb * size, SHIM_ALIGN);   /* The static buffer is still zero */
+    }
+    if (nmemb == 0 || size == 0) {
+        nmemb = size = 1;
+    }
+    if ((p = mm_calloc(nmemb, size)) == NULL) {
+        errno = ENOMEM;
+    }
+    return p;
+}
+
+/*
+ * realloc - Resize ptr to size bytes. A bootstrap block is moved into the heap; a zero size frees ptr
+ */
+SHIM_EXPORT void *realloc(void *ptr, size_t size) {
+    void *p;
+
+    if (ptr == NULL) {
+        return malloc(size);
+    }
+    if (size == 0) {
+        free(ptr);
+        return NULL;
+    }
+    if (IN_BOOT(ptr)) {
+        if ((p = malloc(size)) != NULL) {
+            memcpy(p, ptr, BOOT_SIZEOF(ptr) < size ? BOOT_SIZEOF(ptr) : size);
+        }
+        return p;
+    }
+    if ((p = mm_realloc(ptr, size)) == NULL) {
+        errno = ENOMEM;
+    }
+    return p;
+}
+
+/*
+ * reallocarray - realloc for an array of nmemb elements of size bytes, failing on overflow
+ */
+SHIM_EXPORT void *reallocarray(void *ptr, size_t nmemb, size_t size) {
+    if (size != 0 && nmemb > (size_t)-1 / size) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    return realloc(ptr, nmemb * size);
+}
+
+/*
+ * posix_memalign - Store a block of size bytes aligned to alignment in *memptr. Returns 0, EINVAL or ENOMEM
+ */
+SHIM_EXPORT int posix_memalign(void **memptr, size_t alignment, size_t size) {
+    void *p;
+
+    if (alignment == 0 || alignment % sizeof(void *) != 0 || (alignment & (alignment - 1)) != 0) {
+        return EINVAL;
+    }
+    if ((p = shim_memalign(alignment, size)) == NULL) {
+        return ENOMEM;
+    }
+    *memptr = p;
+    return 0;
+}
+
+/*
+ * aligned_alloc - Allocate size bytes aligned to alignment, a power of two
+ */
+SHIM_EXPORT void *aligned_alloc(size_t alignment, size_t size) {
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0) {
+        errno = EINVAL;
+        return NULL;
+    }
+    return shim_memalign(alignment, size);
+}
+
+/*
+ * memalign - Obsolete form of aligned_alloc. Replaced too, or the C library would hand out blocks free cannot take
+ */
+SHIM_EXPORT void *memalign(size_t alignment, size_t size) {
+    return aligned_alloc(alignment, size);
+}
+
+/*
+ * valloc - Allocate size bytes aligned to a page
+ */
+SHIM_EXPORT void *valloc(size_t size) {
+    return shim_memalign(mem_pagesize(), size);
+}
+
+/*
+ * pvalloc - Allocate size bytes rounded up to whole pages, aligned to a page
+ */
+SHIM_EXPORT void *pvalloc(size_t size) {
+    size_t pagesize = mem_pagesize();
+
+    if (size > (size_t)-1 - pagesize) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    return shim_memalign(pagesize, (size + pagesize - 1) & ~(pagesize - 1));
+}
+
+/*
+ * malloc_usable_size - Return the number of bytes of ptr that may be used
+ */
+SHIM_EXPORT size_t malloc_usable_size(void *ptr) {
+    if (ptr == NULL) {
+        return 0;
+    }
+    if (IN_BOOT(ptr)) {
+        return BOOT_SIZEOF(ptr);
+    }
+    return mm_usable_size(ptr);
+}
+
+/*
+ * The remaining routines are internal helper routines
+ */
+
+/*
+ * shim_init - Set up the heap on the first call. Returns 1 once the heap can be used, or 0 if the caller is the
+ *             setup itself (or an earlier setup failed) and must use the bootstrap buffer
+ */
+static int shim_init(void) {
+    int state = __atomic_load_n(&shim_state, __ATOMIC_ACQUIRE);
+
+    if (state == SHIM_READY) {
+        return 1;
+    }
+    if (state == SHIM_FAILED || shim_initializing) {
+        return 0;
+    }
+    if (state == SHIM_NONE && __sync_bool_compare_and_swap(&shim_state, SHIM_NONE, SHIM_BUSY)) {
+        shim_initializing = 1;
+        mem_init();
+        if (mm_init() < 0) {
+            shim_initializing = 0;
+            __atomic_store_n(&shim_state, SHIM_FAILED, __ATOMIC_RELEASE);
+            return 0;
+        }
+        shim_initializing = 0;
+        __atomic_store_n(&shim_state, SHIM_READY, __ATOMIC_RELEASE);
+#if MM_TRACE
+        if (getenv("MM_TRACE_FILE") != NULL) {
+            mm_trace_start(getenv("MM_TRACE_FILE"), getenv("MM_TRACE_TIMED") != NULL ? MM_TRACE_TIMED : 0);
+        }
+#endif
+        return 1;
+    }
+
+    /* Another thread is setting up the heap */
+    while ((state = __atomic_load_n(&shim_state, __ATOMIC_ACQUIRE)) == SHIM_BUSY) {
+        sched_yield();
+    }
+    return state == SHIM_READY;
+}
+
+#if MM_TRACE
+/*
+ * shim_trace_stop - Write out the rest of the trace when the program exits
+ */
+static void shim_trace_stop(void) {
+    mm_trace_stop();
+}
+#endif
+
+/*
+ * boot_alloc - Carve size bytes aligned to align from the bootstrap buffer. Returns NULL once it is used up
+ */
+static void *boot_alloc(size_t size, size_t align) {
+    size_t old, start, end;
+
+    if (align < SHIM_ALIGN) {
+        align = SHIM_ALIGN;
+    }
+    do {
+        old = __atomic_load_n(&boot_top, __ATOMIC_RELAXED);
+        start = (old + sizeof(size_t) + align - 1) & ~(align - 1);
+        end = start + size;
+        if (size > BOOT_SIZE || end > BOOT_SIZE) {
+            errno = ENOMEM;
+            return NULL;
+        }
+    } while (!__sync_bool_compare_and_swap(&boot_top, old, end));
+    BOOT_SIZEOF(boot_buf + start) = size;
+    return boot_buf + start;
+}
+
+/*
+ * shim_memalign - Allocate size bytes aligned to align, a power of two, or to SHIM_ALIGN if that is larger. A zero
+ *                 size still gets its own block
+ */
+static void *shim_memalign(size_t align, size_t size) {
+    void *p;
+
+    if (align < SHIM_ALIGN) {
+        align = SHIM_ALIGN;
+    }
+    if (!shim_init()) {
+        return boot_alloc(size, align);
+    }
+    if ((p = mm_memalign(align, size ? size : 1)) == NULL) {
+        errno = ENOMEM;
+    }
+    return p;
+}
@@ -0,0 +1,580 @@
+/*
+ * Ian Stephenson   - 44419093
+ * Pok On Cheng     - 75147306
+ * Sung Mo Koo      - 51338217
+ * Cassie Liu       - 52504836
+ */
+
+/*
+ * mmtrace.c - Lock-free per-thread allocation tracing. A thread claims a
+ * ring on its first event and gives it up when it exits, so rings are
+ * reused rather than leaked. Each ring has a single producer (its owner)
+ * and a single consumer (the drain thread): the owner only advances head,
+ * the drainer only advances tail. A full ring drops events and counts
+ * them instead of blocking the allocator. Nothing here calls stdio or
+ * malloc, so tracing is safe underneath an interposed malloc.
+ *
+ * Blocks are numbered through a table from address to id, an open
+ * addressing hash table that threads update with compare-and-swap. A free
+ * takes its block out of the table before the block can be reused, and a
+ * realloc takes the old block out before it is resized, so an address is
+ * in the table at most once. A block allocated before tracing started is
+ * not in the table; its free is not recorded and its realloc is recorded
+ * as an allocation. Each ring hands out ids from a range of TRACE_ID_RANGE
+ * that it takes from next_id, so threads only meet on next_seq, the one
+ * counter every event shares to keep the order of the calls.
+ *
+ * A removed block leaves a tombstone that a later insert may take over.
+ * Tombstones that no insert reuses would lengthen every search, so once the
+ * rings have counted TRACE_TOMBS of them the drain thread rebuilds the table
+ * without them. A thread flags its ring while it works on the table; the
+ * drainer freezes the table, waits for every flag to clear and copies it.
+ * The rebuild is the one step that holds threads off. The drain thread
+ * packs records into a buffer and writes it out in large pieces.
+ */
+#include "config.h"
+
+#if MM_TRACE
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+
+#include "mmtrace.h"
+
+#define TRACE_RING   (1<<16)     /* Events per ring; must be a power of 2 */
+#define TRACE_PERIOD 1000000L    /* Nanoseconds between drains */
+#define TRACE_IDS    (1<<22)     /* Slots in the address to id table; must be a power of 2 */
+#define TRACE_TOMBS  (TRACE_IDS/8)  /* Tombstones in the table that trigger a rebuild */
+#define TRACE_ID_RANGE 1024      /* Block ids a ring takes from next_id at a time */
+#define TRACE_BUF    (1<<16)     /* Bytes of records written at a time */
+
+/* Address to id table slots: empty, and emptied by a free */
+#define SLOT_EMPTY   0
+#define SLOT_FREED   1
+
+typedef struct trace_ring {
+    struct trace_ring *next;     /* All rings, newest first */
+    int in_use;                  /* Owned by a live thread */
+    uint32_t tid;                /* Ring number, recorded in its events */
+    unsigned long head;          /* Next slot to write; only the owner stores it */
+    unsigned long tail;          /* Next slot to drain; only the drainer stores it */
+    unsigned long dropped;       /* Events lost because the ring was full */
+    int in_ids;                  /* Set while the owner works on the id table */
+    long tombs;                  /* Tombstones the owner left less those it reused; may be negative */
+    uint32_t id_next;            /* Next id of the owner's range, */
+    uint32_t id_end;             /* and the end of the range */
+    mm_trace_event_t ev[TRACE_RING];
+} trace_ring_t;
+
+typedef struct {
+    uintptr_t ptr;               /* Block address, SLOT_EMPTY or SLOT_FREED */
+    uint32_t id;
+} trace_slot_t;
+
+/* Global variables */
+static trace_ring_t *rings;              /* Rings are never freed, so this list only grows */
+static uint32_t nrings;
+static int trace_fd = -1;
+static int tracing;                      /* Set while events are being recorded */
+static int timed;                        /* Record timestamps (MM_TRACE_TIMED) */
+static size_t record_size;               /* Bytes written per event */
+static uint64_t next_seq;                /* Events recorded */
+static uint32_t next_id;                 /* Last block id given to a ring's range */
+static unsigned long lost;               /* Blocks dropped because the id table was full */
+static trace_slot_t *ids;                /* Address to id table, mapped on first use */
+static int ids_frozen;                   /* Set while the drain thread rebuilds the id table */
+static char out_buf[TRACE_BUF];          /* Records waiting to be written; only the drainer touches it */
+static size_t out_len;
+static pthread_t drainer;
+static pthread_once_t trace_once = PTHREAD_ONCE_INIT;
+static pthread_key_t ring_key;           /* Only used to give up a thread's ring when it exits */
+static __thread trace_ring_t *my_ring;
+static __thread uint32_t realloc_id;     /* Id of the block being resized by this thread */
+
+/* Function prototypes for internal helper routines */
+static void trace_once_init(void);
+static void trace_fork_child(void);
+static trace_ring_t *ring_claim(void);
+static void ring_release(void *ring);
+static void *drain_loop(void *unused);
+static void record(trace_ring_t *r, int op, uint32_t id, size_t size);
+static uint32_t id_new(trace_ring_t *r);
+static unsigned long id_slot(void *ptr);
+static trace_slot_t *ids_enter(trace_ring_t *r);
+static void ids_exit(trace_ring_t *r);
+static int id_insert(trace_ring_t *r, void *ptr, uint32_t id);
+static uint32_t id_remove(trace_ring_t *r, void *ptr);
+static void id_rebuild(void);
+static void drain(void);
+static void flush_out(void);
+static int write_all(const void *buf, size_t len);
+
+/*
+ * mm_trace_start - Start recording events into a new file at path, with timestamps if flags has MM_TRACE_TIMED.
+ *                  Returns 0 on success, -1 if tracing is already on or the file, the id table or the drain thread
+ *                  cannot be created.
+ */
+int mm_trace_start(const char *path, int flags) {
+    mm_trace_header_t hdr;
+    trace_ring_t *r;
+
+    if (tracing) {
+        return -1;
+    }
+    pthread_once(&trace_once, trace_once_init);
+
+    /* Discard events left in the rings by a previous trace, and every id it handed out */
+    drain();
+    out_len = 0;
+    if (ids == NULL) {
+        ids = mmap(NULL, TRACE_IDS * sizeof(trace_slot_t), PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (ids == MAP_FAILED) {
+            ids = NULL;
+            return -1;
+        }
+    }
+    else {
+        madvise(ids, TRACE_IDS * sizeof(trace_slot_t), MADV_DONTNEED);
+    }
+    next_seq = 0;
+    next_id = 0;
+    lost = 0;
+    for (r = rings; r != NULL; r = r->next) {
+        r->tombs = 0;
+        r->id_next = r->id_end = 0;
+    }
+    timed = (flags & MM_TRACE_TIMED) != 0;
+    record_size = timed ? sizeof(mm_trace_event_t) : MM_TRACE_UNTIMED;
+
+    if ((trace_fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644)) < 0) {
+        return -1;
+    }
+    memset(&hdr, 0, sizeof(hdr));
+    strcpy(hdr.magic, MM_TRACE_MAGIC);
+    hdr.version = MM_TRACE_VERSION;
+    hdr.event_size = record_size;
+    if (write_all(&hdr, sizeof(hdr)) < 0) {
+        close(trace_fd);
+        trace_fd = -1;
+        return -1;
+    }
+    __atomic_store_n(&tracing, 1, __ATOMIC_RELEASE);
+    if (pthread_create(&drainer, NULL, drain_loop, NULL) != 0) {
+        __atomic_store_n(&tracing, 0, __ATOMIC_RELEASE);
+        close(trace_fd);
+        trace_fd = -1;
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * mm_trace_stop - Stop recording, write out every event still in the rings and close the file. Returns the number
+ *                 of events dropped because a ring or the id table was full.
+ */
+unsigned long mm_trace_stop(void) {
+    unsigned long dropped;
+    trace_ring_t *r;
+
+    if (!tracing) {
+        return 0;
+    }
+    __atomic_store_n(&tracing, 0, __ATOMIC_RELEASE);
+    pthread_join(drainer, NULL);
+    drain();
+    flush_out();
+    close(trace_fd);
+    trace_fd = -1;
+
+    dropped = __atomic_exchange_n(&lost, 0, __ATOMIC_RELAXED);
+    for (r = rings; r != NULL; r = r->next) {
+        dropped += __atomic_exchange_n(&r->dropped, 0, __ATOMIC_RELAXED);
+    }
+    return dropped;
+}
+
+/*
+ * mm_trace_event - Record one call: ptr is the block returned or freed, old the block passed to mm_realloc. Failed
+ *                  calls and frees of untracked blocks are not recorded. Costs one load when tracing is off
+ */
+void mm_trace_event(int op, void *ptr, size_t size, void *old) {
+    trace_ring_t *r;
+    uint32_t id;
+
+    if (!__atomic_load_n(&tracing, __ATOMIC_RELAXED)) {
+        return;
+    }
+    if ((r = my_ring) == NULL && (r = ring_claim()) == NULL) {
+        return;
+    }
+    switch (op) {
+    case MM_TRACE_FREE:
+        if (ptr == NULL || (id = id_remove(r, ptr)) == 0) {
+            return;
+        }
+        break;
+
+    case MM_TRACE_REALLOC:
+        id = realloc_id;
+        if (ptr == NULL) {
+            /* Either realloc(old, 0) freed old, or it failed and old is still allocated */
+            if (size != 0 && id != 0 && id_insert(r, old, id) < 0) {
+                __atomic_fetch_add(&lost, 1, __ATOMIC_RELAXED);
+            }
+            if (size != 0 || id == 0) {
+                return;
+            }
+            op = MM_TRACE_FREE;
+            break;
+        }
+        if (id == 0) {
+            op = MM_TRACE_MALLOC;
+            id = id_new(r);
+        }
+        if (id_insert(r, ptr, id) < 0) {
+            __atomic_fetch_add(&lost, 1, __ATOMIC_RELAXED);
+            return;
+        }
+        break;
+
+    default:
+        if (ptr == NULL) {
+            return;
+        }
+        id = id_new(r);
+        if (id_insert(r, ptr, id) < 0) {
+            __atomic_fetch_add(&lost, 1, __ATOMIC_RELAXED);
+            return;
+        }
+        break;
+    }
+    record(r, op, id, size);
+}
+
+/*
+ * mm_trace_realloc_begin - Take the block old out of the id table before mm_realloc may free it, and keep its id
+ *                          for the mm_trace_event that ends the call
+ */
+void mm_trace_realloc_begin(void *old) {
+    trace_ring_t *r;
+
+    realloc_id = 0;
+    if (old != NULL && __atomic_load_n(&tracing, __ATOMIC_RELAXED)) {
+        if ((r = my_ring) != NULL || (r = ring_claim()) != NULL) {
+            realloc_id = id_remove(r, old);
+        }
+    }
+}
+
+/*
+ * The remaining routines are internal helper routines
+ */
+
+/*
+ * record - Append an event to ring r, the calling thread's, or count it as dropped if the ring is full
+ */
+static void record(trace_ring_t *r, int op, uint32_t id, size_t size) {
+    mm_trace_event_t *e;
+    struct timespec ts;
+    unsigned long head;
+
+    head = r->head;
+    if (head - __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE) == TRACE_RING) {
+        __atomic_fetch_add(&r->dropped, 1, __ATOMIC_RELAXED);
+        return;
+    }
+    e = &r->ev[head & (TRACE_RING-1)];
+    e->seq = __atomic_fetch_add(&next_seq, 1, __ATOMIC_RELAXED);
+    e->size = size;
+    e->id = id;
+    e->op = op;
+    e->tid = r->tid;
+    if (timed) {
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        e->time = (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+    }
+    __atomic_store_n(&r->head, head + 1, __ATOMIC_RELEASE);
+}
+
+/*
+ * id_new - Return the next id of ring r's range, taking a new range from next_id when it runs out
+ */
+static uint32_t id_new(trace_ring_t *r) {
+    if (r->id_next == r->id_end) {
+        r->id_next = __atomic_fetch_add(&next_id, TRACE_ID_RANGE, __ATOMIC_RELAXED) + 1;
+        r->id_end = r->id_next + TRACE_ID_RANGE;
+    }
+    return r->id_next++;
+}
+
+/*
+ * id_slot - Return the table slot where the search for ptr starts
+ */
+static unsigned long id_slot(void *ptr) {
+    return (unsigned long)((((uint64_t)(uintptr_t)ptr >> 4) * 0x9E3779B97F4A7C15ULL) >> 32) & (TRACE_IDS-1);
+}
+
+/*
+ * ids_enter - Flag ring r as working on the id table, waiting out a rebuild if one is under way. Returns the table.
+ *             The flag is set before the frozen check, and id_rebuild sets frozen before it checks the flags, so at
+ *             least one of them sees the other
+ */
+static trace_slot_t *ids_enter(trace_ring_t *r) {
+    for (;;) {
+        __atomic_store_n(&r->in_ids, 1, __ATOMIC_SEQ_CST);
+        if (!__atomic_load_n(&ids_frozen, __ATOMIC_SEQ_CST)) {
+            return __atomic_load_n(&ids, __ATOMIC_ACQUIRE);
+        }
+        __atomic_store_n(&r->in_ids, 0, __ATOMIC_RELEASE);
+        while (__atomic_load_n(&ids_frozen, __ATOMIC_ACQUIRE)) {
+            sched_yield();
+        }
+    }
+}
+
+/*
+ * ids_exit - Clear ring r's id table flag
+ */
+static void ids_exit(trace_ring_t *r) {
+    __atomic_store_n(&r->in_ids, 0, __ATOMIC_RELEASE);
+}
+
+/*
+ * id_insert - Give the block at ptr the id id, on behalf of ring r. Returns 0 on success, -1 if the table is full
+ */
+static int id_insert(trace_ring_t *r, void *ptr, uint32_t id) {
+    trace_slot_t *t = ids_enter(r);
+    unsigned long i = id_slot(ptr);
+    unsigned long n;
+    uintptr_t k;
+    int rc = -1;
+
+    for (n = 0; n < TRACE_IDS; n++, i = (i + 1) & (TRACE_IDS-1)) {
+        k = __atomic_load_n(&t[i].ptr, __ATOMIC_RELAXED);
+        if ((k == SLOT_EMPTY || k == SLOT_FREED) && __sync_bool_compare_and_swap(&t[i].ptr, k, (uintptr_t)ptr)) {
+            /* No other thread looks ptr up until it has been returned */
+            t[i].id = id;
+            if (k == SLOT_FREED) {
+                __atomic_store_n(&r->tombs, r->tombs - 1, __ATOMIC_RELAXED);   /* Only the owner stores it */
+            }
+            rc = 0;
+            break;
+        }
+    }
+    ids_exit(r);
+    return rc;
+}
+
+/*
+ * id_remove - Take the block at ptr out of the table, on behalf of ring r. Returns its id, or 0 if it is not in the
+ *             table
+ */
+static uint32_t id_remove(trace_ring_t *r, void *ptr) {
+    trace_slot_t *t = ids_enter(r);
+    unsigned long i = id_slot(ptr);
+    unsigned long n;
+    uintptr_t k;
+    uint32_t id = 0;
+
+    for (n = 0; n < TRACE_IDS; n++, i = (i + 1) & (TRACE_IDS-1)) {
+        k = __atomic_load_n(&t[i].ptr, __ATOMIC_ACQUIRE);
+        if (k == SLOT_EMPTY) {
+            break;
+        }
+        if (k == (uintptr_t)ptr) {
+            id = t[i].id;
+            __atomic_store_n(&t[i].ptr, SLOT_FREED, __ATOMIC_RELEASE);
+            __atomic_store_n(&r->tombs, r->tombs + 1, __ATOMIC_RELAXED);
+            break;
+        }
+    }
+    ids_exit(r);
+    return id;
+}
+
+/*
+ * id_rebuild - Once the rings have counted TRACE_TOMBS tombstones, copy the live entries of the id table into a
+ *              fresh table without them. Only the drain thread calls it. If the new table cannot be mapped, the old
+ *              one stays in use
+ */
+static void id_rebuild(void) {
+    trace_slot_t *old, *new;
+    trace_ring_t *r, *list;
+    unsigned long i, j;
+    long tombs = 0;
+
+    list = __atomic_load_n(&rings, __ATOMIC_ACQUIRE);
+    for (r = list; r != NULL; r = r->next) {
+        tombs += __atomic_load_n(&r->tombs, __ATOMIC_RELAXED);
+    }
+    if (tombs < TRACE_TOMBS) {
+        return;
+    }
+    new = mmap(NULL, TRACE_IDS * sizeof(trace_slot_t), PROT_READ | PROT_WRITE,
+               MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (new == MAP_FAILED) {
+        return;
+    }
+
+    /* Freeze the table and wait until no thread is still working on it; a ring added since is seen frozen */
+    __atomic_store_n(&ids_frozen, 1, __ATOMIC_SEQ_CST);
+    list = __atomic_load_n(&rings, __ATOMIC_ACQUIRE);
+    for (r = list; r != NULL; r = r->next) {
+        while (__atomic_load_n(&r->in_ids, __ATOMIC_SEQ_CST)) {
+            sched_yield();
+        }
+    }
+    old = ids;
+    for (i = 0; i < TRACE_IDS; i++) {
+        if (old[i].ptr == SLOT_EMPTY || old[i].ptr == SLOT_FREED) {
+            continue;
+        }
+        for (j = id_slot((void *)old[i].ptr); new[j].ptr != SLOT_EMPTY; j = (j + 1) & (TRACE_IDS-1))
+            ;
+        new[j] = old[i];
+    }
+    for (r = list; r != NULL; r = r->next) {
+        __atomic_store_n(&r->tombs, 0, __ATOMIC_RELAXED);
+    }
+    __atomic_store_n(&ids, new, __ATOMIC_RELEASE);
+    __atomic_store_n(&ids_frozen, 0, __ATOMIC_SEQ_CST);
+    munmap(old, TRACE_IDS * sizeof(trace_slot_t));
+}
+
+/*
+ * trace_once_init - Create the key whose destructor gives up an exiting thread's ring, and stop a forked child from
+ *                   tracing into its parent's file
+ */
+static void trace_once_init(void) {
+    pthread_key_create(&ring_key, ring_release);
+    pthread_atfork(NULL, NULL, trace_fork_child);
+}
+
+/*
+ * trace_fork_child - Turn tracing off in a forked child, which has no drain thread. The parent keeps the file
+ */
+static void trace_fork_child(void) {
+    trace_ring_t *r;
+
+    tracing = 0;
+    /* The other threads of the parent, and a rebuild it was doing, are gone */
+    ids_frozen = 0;
+    for (r = rings; r != NULL; r = r->next) {
+        r->in_ids = 0;
+    }
+    if (trace_fd >= 0) {
+        close(trace_fd);
+        trace_fd = -1;
+    }
+}
+
+/*
+ * ring_claim - Give the calling thread a ring: one left by a thread that exited, or a new one. Returns NULL if a
+ *              new ring cannot be mapped
+ */
+static trace_ring_t *ring_claim(void) {
+    trace_ring_t *r;
+
+    for (r = __atomic_load_n(&rings, __ATOMIC_ACQUIRE); r != NULL; r = r->next) {
+        if (!r->in_use && __sync_bool_compare_and_swap(&r->in_use, 0, 1)) {
+            break;
+        }
+    }
+    if (r == NULL) {
+        r = mmap(NULL, sizeof(*r), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (r == MAP_FAILED) {
+            return NULL;
+        }
+        r->in_use = 1;
+        r->tid = __sync_fetch_and_add(&nrings, 1);
+        do {
+            r->next = rings;
+        } while (!__sync_bool_compare_and_swap(&rings, r->next, r));
+    }
+
+    /* Set my_ring first: pthread_setspecific may allocate, and that allocation is traced into this ring */
+    my_ring = r;
+    pthread_once(&trace_once, trace_once_init);
+    pthread_setspecific(ring_key, r);
+    return r;
+}
+
+/*
+ * ring_release - Key destructor run at thread exit: let another thread claim this ring. Events still in it are
+ *                drained as usual
+ */
+static void ring_release(void *ring) {
+    my_ring = NULL;
+    __atomic_store_n(&((trace_ring_t *)ring)->in_use, 0, __ATOMIC_RELEASE);
+}
+
+/*
+ * drain_loop - Body of the drain thread: drain the rings and rebuild the id table if it needs it every
+ *              TRACE_PERIOD until tracing stops
+ */
+static void *drain_loop(void *unused) {
+    struct timespec period = { 0, TRACE_PERIOD };
+
+    (void)unused;
+    while (__atomic_load_n(&tracing, __ATOMIC_ACQUIRE)) {
+        drain();
+        id_rebuild();
+        nanosleep(&period, NULL);
+    }
+    return NULL;
+}
+
+/*
+ * drain - Move every recorded event into the output buffer, one ring at a time, writing the buffer out whenever it
+ *         fills. With no file open the events are discarded
+ */
+static void drain(void) {
+    unsigned long head, tail;
+    trace_ring_t *r;
+
+    for (r = __atomic_load_n(&rings, __ATOMIC_ACQUIRE); r != NULL; r = r->next) {
+        tail = r->tail;
+        head = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+        for (; tail != head && trace_fd >= 0; tail++) {
+            if (out_len + record_size > TRACE_BUF) {
+                flush_out();
+            }
+            memcpy(out_buf + out_len, &r->ev[tail & (TRACE_RING-1)], record_size);
+            out_len += record_size;
+        }
+        __atomic_store_n(&r->tail, head, __ATOMIC_RELEASE);
+    }
+}
+
+/*
+ * flush_out - Write out the output buffer
+ */
+static void flush_out(void) {
+    if (out_len > 0 && trace_fd >= 0) {
+        write_all(out_buf, out_len);
+    }
+    out_len = 0;
+}
+
+/*
+ * write_all - Write len bytes of buf to the trace file, retrying short writes. Returns 0 on success, -1 on error
+ */
+static int write_all(const void *buf, size_t len) {
+    const char *p = buf;
+    ssize_t n;
+
+    while (len > 0) {
+        if ((n = write(trace_fd, p, len)) < 0) {
+            return -1;
+        }
+        p += n;
+        len -= n;
+    }
+    return 0;
+}
+#endif
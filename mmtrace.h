@@ -0,0 +1,71 @@
+/*
+ * Ian Stephenson   - 44419093
+ * Pok On Cheng     - 75147306
+ * Sung Mo Koo      - 51338217
+ * Cassie Liu       - 52504836
+ */
+
+#ifndef __MMTRACE_H_
+#define __MMTRACE_H_
+
+/*
+ * mmtrace.h - Allocation event tracing, built when MM_TRACE is 1.
+ *
+ * Each thread records events into a ring buffer of its own without taking
+ * a lock; a background thread started by mm_trace_start drains the rings
+ * into a binary file. Blocks are not identified by address but by id: a
+ * block gets the next id when it is allocated and keeps it across
+ * mm_realloc, so a trace can be replayed (see trace2rep.c) without caring
+ * where the blocks landed. The file is a mm_trace_header_t followed by
+ * records of event_size bytes, the leading part of a mm_trace_event_t,
+ * which omits the time unless the trace was started with
+ * MM_TRACE_TIMED. Records are in order per thread; sorting all of them by
+ * seq gives the order of the calls. With MM_TRACE 0 the TRACE hooks expand
+ * to nothing.
+ */
+#include <stddef.h>
+#include <stdint.h>
+
+#define MM_TRACE_MAGIC   "MMTRACE"
+#define MM_TRACE_VERSION 2
+
+/* Event ops */
+#define MM_TRACE_MALLOC  1      /* ptr = mm_malloc(size) */
+#define MM_TRACE_FREE    2      /* mm_free(ptr) */
+#define MM_TRACE_REALLOC 3      /* ptr = mm_realloc(old, size) */
+#define MM_TRACE_CALLOC  4      /* ptr = mm_calloc(1, size) */
+
+/* mm_trace_start flags */
+#define MM_TRACE_TIMED   0x1    /* Record a timestamp with every event */
+
+typedef struct {
+    char magic[8];              /* MM_TRACE_MAGIC, NUL padded */
+    uint32_t version;           /* MM_TRACE_VERSION */
+    uint32_t event_size;        /* Bytes per record: MM_TRACE_UNTIMED or sizeof(mm_trace_event_t) */
+} mm_trace_header_t;
+
+typedef struct {
+    uint64_t seq;               /* Event number, counted across all threads */
+    uint64_t size;              /* Requested size */
+    uint32_t id;                /* Block allocated, resized or freed, numbered from 1 */
+    uint16_t op;                /* MM_TRACE_xxx */
+    uint16_t tid;               /* Ring that recorded the event, one per live thread */
+    uint64_t time;              /* CLOCK_MONOTONIC nanoseconds (MM_TRACE_TIMED only) */
+} mm_trace_event_t;
+
+#define MM_TRACE_UNTIMED  offsetof(mm_trace_event_t, time)  /* Record size without the time */
+
+#if MM_TRACE
+int mm_trace_start(const char *path, int flags);
+unsigned long mm_trace_stop(void);
+void mm_trace_event(int op, void *ptr, size_t size, void *old);
+void mm_trace_realloc_begin(void *old);
+
+#define TRACE(op, ptr, size, old)  mm_trace_event(op, ptr, size, old)
+#define TRACE_REALLOC_BEGIN(old)   mm_trace_realloc_begin(old)
+#else
+#define TRACE(op, ptr, size, old)
+#define TRACE_REALLOC_BEGIN(old)
+#endif
+
+#endif /* __MMTRACE_H_ */
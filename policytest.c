@@ -0,0 +1,124 @@
+/*
+ * Ian Stephenson   - 44419093
+ * Pok On Cheng     - 75147306
+ * Sung Mo Koo      - 51338217
+ * Cassie Liu       - 52504836
+ */
+
+/*
+ * policytest.c - Switch the placement policy with mm_set_policy while other
+ * threads allocate, resize and free. Each worker fills its blocks with a
+ * pattern of its own and checks it before every free, so a free index left
+ * built for the wrong policy shows up as a crash or a corrupted block.
+ * Exits with status 0 if every block came back intact.
+ *
+ * Build with: gcc -O2 -I. -DMM_THREADSAFE=1 policytest.c mm.c memlib.c csapp.c -lpthread
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "csapp.h"
+#include "memlib.h"
+#include "mm.h"
+
+#define NWORKERS  6         /* Threads allocating */
+#define NSWITCHERS 2        /* Threads switching policy */
+#define NSLOTS    256       /* Blocks each worker keeps */
+#define NOPS      200000    /* Ops per worker */
+#define MAXSIZE   2048      /* Largest request (bytes) */
+
+/* Global variables */
+static volatile int done;   /* Set when the workers have finished */
+static int errors;
+
+/*
+ * check - Return 1 if the first size bytes of p all hold c, else 0
+ */
+static int check(unsigned char *p, size_t size, unsigned char c) {
+    size_t i;
+
+    for (i = 0; i < size; i++) {
+        if (p[i] != c)
+            return 0;
+    }
+    return 1;
+}
+
+/*
+ * worker - Allocate, resize and free random blocks, checking each one's pattern before it goes
+ */
+static void *worker(void *vargp) {
+    unsigned int seed = (unsigned int)(long)vargp;
+    unsigned char c = (unsigned char)(long)vargp;
+    unsigned char *p[NSLOTS];
+    size_t size[NSLOTS];
+    int i, j;
+
+    memset(p, 0, sizeof(p));
+    for (i = 0; i < NOPS; i++) {
+        j = rand_r(&seed) % NSLOTS;
+        if (p[j] != NULL && !check(p[j], size[j], c)) {
+            __sync_fetch_and_add(&errors, 1);
+        }
+        if (p[j] != NULL && rand_r(&seed) % 4 == 0) {
+            size[j] = 1 + rand_r(&seed) % MAXSIZE;
+            if ((p[j] = mm_realloc(p[j], size[j])) == NULL) {
+                __sync_fetch_and_add(&errors, 1);
+                continue;
+            }
+        }
+        else {
+            mm_free(p[j]);
+            size[j] = 1 + rand_r(&seed) % MAXSIZE;
+            if ((p[j] = mm_malloc(size[j])) == NULL) {
+                __sync_fetch_and_add(&errors, 1);
+                continue;
+            }
+        }
+        memset(p[j], c, size[j]);
+    }
+    for (j = 0; j < NSLOTS; j++) {
+        if (p[j] != NULL && !check(p[j], size[j], c)) {
+            __sync_fetch_and_add(&errors, 1);
+        }
+        mm_free(p[j]);
+    }
+    return NULL;
+}
+
+/*
+ * switcher - Cycle through the placement policies until the workers are done
+ */
+static void *switcher(void *vargp) {
+    static const int policies[] = { MM_FIRSTFIT, MM_NEXTFIT, MM_BESTFIT, MM_SEGFIT };
+    int i = (int)(long)vargp;
+
+    while (!done) {
+        if (mm_set_policy(policies[i++ % 4]) != 0) {
+            __sync_fetch_and_add(&errors, 1);
+        }
+    }
+    return NULL;
+}
+
+int main(void) {
+    pthread_t workers[NWORKERS], switchers[NSWITCHERS];
+    long i;
+
+    mem_init();
+    if (mm_init() < 0)
+        app_error("mm_init failed");
+    for (i = 0; i < NSWITCHERS; i++)
+        Pthread_create(&switchers[i], NULL, switcher, (void *)i);
+    for (i = 0; i < NWORKERS; i++)
+        Pthread_create(&workers[i], NULL, worker, (void *)(i + 1));
+    for (i = 0; i < NWORKERS; i++)
+        Pthread_join(workers[i], NULL);
+    done = 1;
+    for (i = 0; i < NSWITCHERS; i++)
+        Pthread_join(switchers[i], NULL);
+
+    printf("%s: %d errors\n", errors ? "FAIL" : "PASS", errors);
+    return errors != 0;
+}
@@ -26,6 +26,7 @@ int main() {
     /* Initialize the memory system and memory manager */
     mem_init();
     mm_init();
+    mm_setopt(MM_OPT_QUICK_MAX, 0);   /* Show freed blocks as free at once */
     
     while (1) {
         /* Read */
@@ -66,9 +67,8 @@ void builtin_command(char **argv) {
     /* allocate command */
     else if (!strcmp(argv[0], "allocate")) {
         /*
-         * Allocating using firstfit or bestfit is automatically handled by a macro flag NEXT_FIT. If NEXT_FIT is defined
-         * then the allocation search algorithm will be bestfit, and if NEXT_FIT is not defined then firstfit will be
-         * used. By default firstfit is used.
+         * Allocating uses whichever placement policy was last selected with the firstfit, nextfit, bestfit or segfit
+         * commands. By default segregated fit is used.
          */
 
         /* Need to test if the following argument is an integer; else it should fail */
@@ -82,11 +82,16 @@ void builtin_command(char **argv) {
         else {
 			/* Convert string command line argument to unsigned integer */
 			size_t size_to_allocate = (size_t) atoi(argv[1]);
-            mm_malloc(size_to_allocate);
-        }
+            int handle = mm_halloc(size_to_allocate);
 
-		/* Print the block number associated with the just-allocated block */
-		// printf("Just-allocated block number goes here\n");
+            /* Print the block number associated with the just-allocated block */
+            if (handle < 0) {
+                printf("Out of memory. Nothing allocated.\n");
+            }
+            else {
+                printf("%d\n", handle);
+            }
+        }
     }
     /* free command */
     else if (!strcmp(argv[0], "free")) {
@@ -96,9 +101,13 @@ void builtin_command(char **argv) {
         }
         else {
 			int blockNumber = atoi(argv[1]);
-			char *bp = getBlockArrayElement(blockNumber);
+			char *bp = mm_hget(blockNumber);
+            if (bp == NULL) {
+                printf("\"%s\": Invalid block number\n", argv[1]);
+                return;
+            }
             mm_freebufferinblock(bp);
-            mm_free(bp);
+            mm_hfree(blockNumber);
         }
     }
     /* blocklist command */
@@ -160,36 +169,31 @@ void builtin_command(char **argv) {
     }
     /* bestfit command */
     else if (!strcmp(argv[0], "bestfit")) {
-		/*
-		 * The flag for using bestfit or firstfit was already written into the code we had. It would test to see if the
-		 * NEXT_FIT macro was defined whenever it needed to user firstfit or bestfit. If NEXT_FIT is defined, then the
-		 * allocation method is bestfit; if the macro is not defined then by default it uses first fit.
-		 *
-		 * So if the user wants to enable bestfit, check to see if NEXT_FIT is defined. If NEXT_FIT is defined, then
-		 * do nothing-- the flag is already set and there is nothing to do. However, if NEXT_FIT is not defined, then
-		 * define the macro and return.
-		 * define it.
-		 */
-		#ifndef NEXT_FIT
-			#define NEXT_FIT
-		#endif
-        return;
+        /*
+         * The placement policy is a runtime setting in mm.c, so switching takes effect on the next allocate without
+         * rebuilding. Blocks that are already allocated stay where they are.
+         */
+        mm_set_policy(MM_BESTFIT);
     }
     /* firstfit command */
     else if (!strcmp(argv[0], "firstfit")) {
-		/*
-		 * The flag for using bestfit or firstfit was already written into the code we had. It would test to see if the
-		 * NEXT_FIT macro was defined whenever it needed to user firstfit or bestfit. If NEXT_FIT is defined, then the
-		 * allocation method is bestfit; if the macro is not defined then by default it uses first fit.
-		 *
-		 * So if the user wants to enable firstfit (and thus disable bestfit), check to see if NEXT_FIT is defined.
-		 * If NEXT_FIT is defined, then undefine NEXT_FIT-- the flag is set and it needs to be disabled. However, if
-		 * NEXT_FIT is not defined, then do nothing-- the flag should be disabled and it already is, so just return.
-		 */
-        #ifdef NEXT_FIT
-			#undef NEXT_FIT
-		#endif
-        return;
+        mm_set_policy(MM_FIRSTFIT);
+    }
+    /* nextfit command */
+    else if (!strcmp(argv[0], "nextfit")) {
+        mm_set_policy(MM_NEXTFIT);
+    }
+    /* segfit command */
+    else if (!strcmp(argv[0], "segfit")) {
+        mm_set_policy(MM_SEGFIT);
+    }
+    /* stats command */
+    else if (!strcmp(argv[0], "stats")) {
+        mm_printstats();
+    }
+    /* trim command */
+    else if (!strcmp(argv[0], "trim")) {
+        mm_trim(0);
     }
     /* Not a builtin command */
     else {
@@ -0,0 +1,245 @@
+/*
+ * Ian Stephenson   - 44419093
+ * Pok On Cheng     - 75147306
+ * Sung Mo Koo      - 51338217
+ * Cassie Liu       - 52504836
+ */
+
+/*
+ * trace2rep.c - Convert a binary allocation trace recorded by mmtrace.c
+ * (for instance from a live program run under mmshim.c with
+ * MM_TRACE_FILE set) into a .rep trace that mdriver can replay.
+ *
+ * The records are sorted by seq to restore the order of the calls across
+ * threads, and the block ids are renumbered densely from 0 in the order
+ * the blocks were first allocated. A realloc of a block the trace never
+ * saw allocated (it was allocated before tracing started, or its record
+ * was dropped) becomes an allocation; a free of such a block is left out.
+ * Blocks still allocated at the end of the trace are freed, so the .rep
+ * trace is balanced, unless -k is given.
+ *
+ * Build with: gcc -O2 -I. trace2rep.c csapp.c -lpthread
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+
+#include "csapp.h"
+#include "mmtrace.h"
+
+#define NONE  (-1)       /* Rep id of a block that is not allocated */
+
+/* One .rep op */
+typedef struct {
+    char type;           /* 'a', 'r' or 'f' */
+    long id;
+    uint64_t size;
+} op_t;
+
+/* Global variables */
+static op_t *ops;        /* Ops generated so far */
+static long nops, maxops;
+
+/* Function prototypes */
+static mm_trace_event_t *read_events(char *filename, size_t *count);
+static int seq_cmp(const void *a, const void *b);
+static void emit(char type, long id, uint64_t size);
+static void usage(void);
+
+/*
+ * main - Read the trace, rebuild the sequence of calls and write the .rep trace
+ */
+int main(int argc, char **argv) {
+    char *outfile = NULL;        /* .rep file to write, or stdout */
+    int keep = 0;                /* Leave blocks allocated at the end (set by -k) */
+    int verbose = 0;
+    mm_trace_event_t *ev;
+    size_t nev, i;
+    long *rep_id = NULL;         /* Rep id of each trace id, or NONE */
+    uint64_t *rep_size = NULL;   /* Size of each allocated block, by rep id */
+    uint32_t max_id = 0;
+    long nids = 0, skipped = 0;
+    uint64_t cur = 0, peak = 0;
+    FILE *fp;
+    long id;
+    int c;
+
+    while ((c = getopt(argc, argv, "o:kvh")) != EOF) {
+        switch (c) {
+        case 'o': /* Output file */
+            outfile = optarg;
+            break;
+        case 'k': /* Keep blocks allocated at the end */
+            keep = 1;
+            break;
+        case 'v': /* Print a summary */
+            verbose = 1;
+            break;
+        case 'h': /* Print this message */
+            usage();
+            exit(0);
+        default:
+            usage();
+            exit(1);
+        }
+    }
+    if (optind != argc - 1) {
+        usage();
+        exit(1);
+    }
+
+    /* Read the records and put them in call order */
+    ev = read_events(argv[optind], &nev);
+    qsort(ev, nev, sizeof(mm_trace_event_t), seq_cmp);
+    for (i = 0; i < nev; i++) {
+        max_id = ev[i].id > max_id ? ev[i].id : max_id;
+    }
+    if ((rep_id = malloc(((size_t)max_id + 1) * sizeof(long))) == NULL ||
+        (rep_size = calloc((size_t)max_id + 1, sizeof(uint64_t))) == NULL)
+        unix_error("malloc failed in main");
+    for (i = 0; i <= max_id; i++) {
+        rep_id[i] = NONE;
+    }
+
+    /* Replay the calls, giving every block a dense id */
+    for (i = 0; i < nev; i++) {
+        switch (ev[i].op) {
+        case MM_TRACE_MALLOC:
+        case MM_TRACE_CALLOC:
+        case MM_TRACE_REALLOC:
+            id = rep_id[ev[i].id];
+            if (ev[i].op == MM_TRACE_REALLOC && id != NONE) {
+                cur += ev[i].size - rep_size[id];
+                emit('r', id, ev[i].size);
+            }
+            else {
+                if (id != NONE) {
+                    /* A free of the block was lost; close it off first */
+                    cur -= rep_size[id];
+                    emit('f', id, 0);
+                }
+                id = rep_id[ev[i].id] = nids++;
+                cur += ev[i].size;
+                emit('a', id, ev[i].size);
+            }
+            rep_size[id] = ev[i].size;
+            break;
+
+        case MM_TRACE_FREE:
+            if ((id = rep_id[ev[i].id]) == NONE) {
+                skipped++;
+                continue;
+            }
+            cur -= rep_size[id];
+            rep_id[ev[i].id] = NONE;
+            emit('f', id, 0);
+            break;
+
+        default:
+            app_error("Bad op in trace");
+        }
+        if (cur > peak)
+            peak = cur;
+    }
+
+    /* Free whatever is left, so the trace is balanced */
+    if (!keep) {
+        for (i = 0; i <= max_id; i++) {
+            if (rep_id[i] != NONE)
+                emit('f', rep_id[i], 0);
+        }
+    }
+
+    /* Write the .rep trace */
+    if (outfile == NULL)
+        fp = stdout;
+    else if ((fp = fopen(outfile, "w")) == NULL)
+        unix_error("Could not open output file");
+    fprintf(fp, "%lu\n%ld\n%ld\n1\n", (unsigned long)peak, nids, nops);
+    for (i = 0; i < (size_t)nops; i++) {
+        if (ops[i].type == 'f')
+            fprintf(fp, "f %ld\n", ops[i].id);
+        else
+            fprintf(fp, "%c %ld %lu\n", ops[i].type, ops[i].id, (unsigned long)ops[i].size);
+    }
+    if (fp != stdout)
+        fclose(fp);
+    if (verbose) {
+        fprintf(stderr, "%lu events, %ld blocks, %ld ops, %ld frees of unknown blocks skipped, peak %lu bytes\n",
+                (unsigned long)nev, nids, nops, skipped, (unsigned long)peak);
+    }
+    return 0;
+}
+
+/*
+ * read_events - Read every record of the trace file into an array of count events. Untimed records get a time of 0
+ */
+static mm_trace_event_t *read_events(char *filename, size_t *count) {
+    mm_trace_header_t hdr;
+    mm_trace_event_t *ev = NULL;
+    size_t n = 0, max = 0;
+    FILE *fp;
+
+    if ((fp = fopen(filename, "rb")) == NULL)
+        unix_error("Could not open trace file");
+    if (fread(&hdr, sizeof(hdr), 1, fp) != 1 || strncmp(hdr.magic, MM_TRACE_MAGIC, sizeof(hdr.magic)) != 0)
+        app_error("Not an allocation trace");
+    if (hdr.version != MM_TRACE_VERSION)
+        app_error("Unsupported trace version");
+    if (hdr.event_size != MM_TRACE_UNTIMED && hdr.event_size != sizeof(mm_trace_event_t))
+        app_error("Bad record size in trace header");
+
+    for (;;) {
+        if (n == max) {
+            max = max ? 2 * max : 65536;
+            if ((ev = realloc(ev, max * sizeof(mm_trace_event_t))) == NULL)
+                unix_error("realloc failed in read_events");
+        }
+        memset(&ev[n], 0, sizeof(mm_trace_event_t));
+        if (fread(&ev[n], hdr.event_size, 1, fp) != 1)
+            break;
+        n++;
+    }
+    fclose(fp);
+    *count = n;
+    return ev;
+}
+
+/*
+ * seq_cmp - qsort comparison of two events by seq
+ */
+static int seq_cmp(const void *a, const void *b) {
+    uint64_t x = ((const mm_trace_event_t *)a)->seq;
+    uint64_t y = ((const mm_trace_event_t *)b)->seq;
+
+    return (x > y) - (x < y);
+}
+
+/*
+ * emit - Append an op to the .rep trace
+ */
+static void emit(char type, long id, uint64_t size) {
+    if (nops == maxops) {
+        maxops = maxops ? 2 * maxops : 4096;
+        if ((ops = realloc(ops, maxops * sizeof(op_t))) == NULL)
+            unix_error("realloc failed in emit");
+    }
+    ops[nops].type = type;
+    ops[nops].id = id;
+    ops[nops].size = size;
+    nops++;
+}
+
+/*
+ * usage - Explain the command line arguments
+ */
+static void usage(void) {
+    fprintf(stderr, "Usage: trace2rep [-hkv] [-o <file>] <trace>\n");
+    fprintf(stderr, "Options\n");
+    fprintf(stderr, "\t-o <file>  Write the .rep trace to <file> instead of stdout.\n");
+    fprintf(stderr, "\t-k         Keep blocks allocated at the end of the trace.\n");
+    fprintf(stderr, "\t-v         Print a summary to stderr.\n");
+    fprintf(stderr, "\t-h         Print this message.\n");
+}